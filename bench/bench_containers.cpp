@@ -0,0 +1,166 @@
+/*
+ * Memory and speed of TinyMap/TinyList against std::unordered_map,
+ * std::list and std::forward_list holding the same ints.
+ *
+ * Usage: bench_containers [elements]   (default 1000000)
+ *
+ * Memory of the standard containers is the heap they hold: every node and
+ * bucket array is counted at its malloc chunk size (usable size plus the
+ * chunk header). They are built in one pass, so their nodes sit next to
+ * each other in the heap, which is their best case for traversal.
+ */
+extern "C" {
+    #include "tiny_ptr_map.h"
+    #include "tiny_ptr_list.h"
+}
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <forward_list>
+#include <list>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+static size_t allocated_bytes = 0;
+
+template <class T>
+struct CountingAllocator {
+    using value_type = T;
+    CountingAllocator() = default;
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+    T* allocate(size_t n) {
+        void* p = std::malloc(n * sizeof(T));
+        if (!p) throw std::bad_alloc();
+        allocated_bytes += malloc_usable_size(p) + sizeof(size_t);
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t) {
+        allocated_bytes -= malloc_usable_size(p) + sizeof(size_t);
+        std::free(p);
+    }
+    template <class U>
+    bool operator==(const CountingAllocator<U>&) const { return true; }
+    template <class U>
+    bool operator!=(const CountingAllocator<U>&) const { return false; }
+};
+
+using StdMap = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                                  CountingAllocator<std::pair<const int, int>>>;
+using StdList = std::list<int, CountingAllocator<int>>;
+using StdForwardList = std::forward_list<int, CountingAllocator<int>>;
+
+template <class Fn>
+static double ns_per_op(size_t ops, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / ops;
+}
+
+static void report(const char* name, size_t bytes, size_t n, double build_ns, double read_ns) {
+    printf("%-22s %10.1f %12.1f %12.1f\n", name, (double)bytes / n, build_ns, read_ns);
+}
+
+static volatile long sink;
+
+static void bench_maps(size_t n) {
+    std::mt19937 rng(42);
+    std::vector<int> keys(n);
+    for (auto& k : keys) k = (int)rng();
+    std::vector<int> probes(keys);
+    std::shuffle(probes.begin(), probes.end(), rng);
+
+    printf("\n%-22s %10s %12s %12s\n", "map", "bytes/elem", "insert ns", "lookup ns");
+
+    TinyMap* tm = tiny_map_create(n, 0.9);
+    double insert_ns = ns_per_op(n, [&] {
+        for (size_t i = 0; i < n; i++) tiny_map_put(tm, keys[i], (int)i);
+    });
+    double lookup_ns = ns_per_op(n, [&] {
+        long sum = 0;
+        int value;
+        for (int k : probes)
+            if (tiny_map_get(tm, k, &value) == 0) sum += value;
+        sink = sum;
+    });
+    report("TinyMap", tiny_map_memory_usage(tm), tiny_map_size(tm), insert_ns, lookup_ns);
+    tiny_map_destroy(tm);
+
+    allocated_bytes = 0;
+    {
+        StdMap sm;
+        sm.reserve(n);
+        insert_ns = ns_per_op(n, [&] {
+            for (size_t i = 0; i < n; i++) sm[keys[i]] = (int)i;
+        });
+        lookup_ns = ns_per_op(n, [&] {
+            long sum = 0;
+            for (int k : probes) {
+                auto it = sm.find(k);
+                if (it != sm.end()) sum += it->second;
+            }
+            sink = sum;
+        });
+        report("std::unordered_map", allocated_bytes + sizeof(sm), sm.size(), insert_ns, lookup_ns);
+    }
+}
+
+static void bench_lists(size_t n) {
+    printf("\n%-22s %10s %12s %12s\n", "list", "bytes/elem", "push ns", "traverse ns");
+
+    TinyList* tl = tiny_list_create(n, 0.9);
+    double push_ns = ns_per_op(n, [&] {
+        for (size_t i = 0; i < n; i++) tiny_list_push_back(tl, (int)i);
+    });
+    double walk_ns = ns_per_op(n, [&] {
+        long sum = 0;
+        for (TinyListPos p = tiny_list_begin(tl); p.tiny_ptr >= 0; p = tiny_list_next(tl, p))
+            sum += tiny_list_value(tl, p);
+        sink = sum;
+    });
+    report("TinyList", tiny_list_memory_usage(tl), tiny_list_size(tl), push_ns, walk_ns);
+    tiny_list_destroy(tl);
+
+    allocated_bytes = 0;
+    {
+        StdList sl;
+        push_ns = ns_per_op(n, [&] {
+            for (size_t i = 0; i < n; i++) sl.push_back((int)i);
+        });
+        walk_ns = ns_per_op(n, [&] {
+            long sum = 0;
+            for (int v : sl) sum += v;
+            sink = sum;
+        });
+        report("std::list", allocated_bytes + sizeof(sl), sl.size(), push_ns, walk_ns);
+    }
+
+    allocated_bytes = 0;
+    {
+        StdForwardList fl;
+        auto tail = fl.before_begin();
+        push_ns = ns_per_op(n, [&] {
+            for (size_t i = 0; i < n; i++) tail = fl.insert_after(tail, (int)i);
+        });
+        walk_ns = ns_per_op(n, [&] {
+            long sum = 0;
+            for (int v : fl) sum += v;
+            sink = sum;
+        });
+        report("std::forward_list", allocated_bytes + sizeof(fl), n, push_ns, walk_ns);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    if (n == 0) n = 1000000;
+    printf("%zu elements\n", n);
+    bench_maps(n);
+    bench_lists(n);
+    return 0;
+}
@@ -0,0 +1,387 @@
+#ifndef TINY_PTR_HPP
+#define TINY_PTR_HPP
+
+/*
+ * Header-only C++17 interface. Bucket size and lock policy are template
+ * parameters, so the slot index is a multiply (or shift) by a constant and
+ * the whole dereference path inlines into the caller. The tiny pointer
+ * width follows from the geometry and is exposed as pointer_bits.
+ *
+ * Tables are move-only RAII objects. A SimpleTable<int, int, N> uses the
+ * same hash, seed and bucket layout as a C SimpleTable with N-slot buckets
+ * and the same capacity and load factor, so tables convert both ways with
+ * every tiny pointer preserved (from_c / to_c).
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include "tiny_ptr_simple.h"
+}
+
+namespace tiny_ptr {
+
+/* Lock policy for tables used by one thread or guarded by the caller */
+struct NullLock {
+    void lock() noexcept {}
+    void unlock() noexcept {}
+};
+
+namespace detail {
+
+/* Bits needed to number n distinct values (at least 1) */
+constexpr unsigned bits_for(std::size_t n) {
+    unsigned bits = 1;
+    while ((std::size_t{1} << bits) < n)
+        bits++;
+    return bits;
+}
+
+template <unsigned Bits>
+using uint_least = std::conditional_t<Bits <= 8, std::uint8_t,
+                   std::conditional_t<Bits <= 16, std::uint16_t, std::uint32_t>>;
+
+/* Same mixing as hash_int_with_seed in tiny_ptr_simple.c */
+inline std::uint32_t hash(std::uint32_t h, std::uint32_t seed) noexcept {
+    h ^= seed;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+template <class Key>
+inline std::uint32_t key_bits(Key key) noexcept {
+    if constexpr (sizeof(Key) > sizeof(std::uint32_t)) {
+        auto k = static_cast<std::uint64_t>(key);
+        return static_cast<std::uint32_t>(k ^ (k >> 32));
+    } else {
+        return static_cast<std::uint32_t>(key);
+    }
+}
+
+/* Bucket count of a C SimpleTable created with the same arguments */
+inline std::size_t bucket_count_for(std::size_t capacity, double load_factor, std::size_t bucket_size) {
+    auto min_slots = static_cast<std::size_t>(std::ceil(static_cast<double>(capacity) / load_factor));
+    std::size_t desired = (min_slots + bucket_size - 1) / bucket_size;
+    std::size_t count = 1;
+    while (count < desired)
+        count *= 2;
+    return count;
+}
+
+}  // namespace detail
+
+template <class Key, class Value, std::size_t BucketSize = 32, class LockPolicy = std::mutex>
+class SimpleTable {
+    static_assert(std::is_integral_v<Key>, "keys are hashed as integers");
+    static_assert(std::is_trivially_copyable_v<Value>, "values are stored in flat arrays");
+    static_assert(BucketSize >= 1 && BucketSize <= 64, "buckets hold 1..64 slots");
+
+public:
+    using key_type = Key;
+    using value_type = Value;
+    static constexpr std::size_t bucket_size = BucketSize;
+    static constexpr unsigned pointer_bits = detail::bits_for(BucketSize);
+    using pointer = detail::uint_least<pointer_bits>;
+
+    explicit SimpleTable(std::size_t capacity, double load_factor = 0.9)
+        : capacity_(capacity), load_factor_(load_factor) {
+        if (capacity == 0 || !(load_factor > 0 && load_factor <= 1.0))
+            throw std::invalid_argument("tiny_ptr::SimpleTable: bad capacity or load factor");
+        bucket_count_ = detail::bucket_count_for(capacity, load_factor, BucketSize);
+        seed_ = static_cast<std::uint32_t>(capacity) ^ 0x9e3779b9u;
+        values_.reset(new Value[bucket_count_ * BucketSize]());
+        keys_.reset(new Key[bucket_count_ * BucketSize]());
+        used_.reset(new std::uint64_t[bucket_count_]());
+        lock_ = std::make_unique<LockPolicy>();
+    }
+
+    SimpleTable(SimpleTable&&) noexcept = default;
+    SimpleTable& operator=(SimpleTable&&) noexcept = default;
+    SimpleTable(const SimpleTable&) = delete;
+    SimpleTable& operator=(const SimpleTable&) = delete;
+
+    std::optional<pointer> allocate(Key key, Value value) {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        std::size_t bucket = bucket_of(key);
+        std::uint64_t free_mask = ~used_[bucket] & full_mask;
+        if (free_mask == 0)
+            return std::nullopt;
+        auto slot = static_cast<pointer>(__builtin_ctzll(free_mask));
+        values_[bucket * BucketSize + slot] = value;
+        keys_[bucket * BucketSize + slot] = key;
+        used_[bucket] |= std::uint64_t{1} << slot;
+        return slot;
+    }
+
+    Value dereference(Key key, pointer tp) const {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        return values_[bucket_of(key) * BucketSize + tp];
+    }
+
+    void free(Key key, pointer tp) {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        std::size_t bucket = bucket_of(key);
+        values_[bucket * BucketSize + tp] = Value();
+        used_[bucket] &= ~(std::uint64_t{1} << tp);
+    }
+
+    /* Number of allocated entries */
+    std::size_t size() const {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        std::size_t live = 0;
+        for (std::size_t b = 0; b < bucket_count_; b++)
+            live += static_cast<std::size_t>(__builtin_popcountll(used_[b]));
+        return live;
+    }
+
+    std::size_t capacity() const noexcept { return capacity_; }
+    double load_factor() const noexcept { return load_factor_; }
+    std::size_t bucket_count() const noexcept { return bucket_count_; }
+
+    /* Calls fn(key, value, tiny_ptr) for every allocated entry */
+    template <class Fn>
+    void for_each(Fn&& fn) const {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        for (std::size_t b = 0; b < bucket_count_; b++) {
+            for (std::uint64_t occupied = used_[b]; occupied; occupied &= occupied - 1) {
+                auto slot = static_cast<pointer>(__builtin_ctzll(occupied));
+                fn(keys_[b * BucketSize + slot], values_[b * BucketSize + slot], slot);
+            }
+        }
+    }
+
+    /*
+     * Copies a C table whose buckets hold BucketSize slots; tiny pointers
+     * issued by the C table stay valid. Throws std::invalid_argument if the
+     * layouts differ.
+     */
+    static SimpleTable from_c(::SimpleTable* st) {
+        static_assert(std::is_same_v<Key, int> && std::is_same_v<Value, int>,
+                      "C tables store int keys and values");
+        SimpleGeometry g;
+        if (simple_geometry(st, &g) != 0 || g.bucket_size != BucketSize)
+            throw std::invalid_argument("tiny_ptr::SimpleTable::from_c: bucket size differs");
+        SimpleTable table(g.capacity, g.load_factor);
+        if (table.bucket_count_ != g.bucket_count || table.seed_ != g.hash_seed)
+            throw std::invalid_argument("tiny_ptr::SimpleTable::from_c: layout differs");
+        simple_visit(st, &SimpleTable::place_visit, &table);
+        return table;
+    }
+
+    /* New C table with the same layout and entries; the caller destroys it */
+    ::SimpleTable* to_c() const {
+        static_assert(std::is_same_v<Key, int> && std::is_same_v<Value, int>,
+                      "C tables store int keys and values");
+        ::SimpleTable* st = simple_create_sized(capacity_, load_factor_, BucketSize);
+        if (!st)
+            throw std::bad_alloc();
+        for_each([st](int key, int value, pointer tp) { simple_insert_at(st, key, value, tp); });
+        return st;
+    }
+
+private:
+    static constexpr std::uint64_t full_mask =
+        BucketSize >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << BucketSize) - 1;
+
+    std::size_t bucket_of(Key key) const noexcept {
+        return detail::hash(detail::key_bits(key), seed_) & (bucket_count_ - 1);
+    }
+
+    static void place_visit(void* ctx, int key, int value, int tiny_ptr) {
+        auto* table = static_cast<SimpleTable*>(ctx);
+        std::size_t bucket = table->bucket_of(key);
+        table->values_[bucket * BucketSize + tiny_ptr] = value;
+        table->keys_[bucket * BucketSize + tiny_ptr] = key;
+        table->used_[bucket] |= std::uint64_t{1} << tiny_ptr;
+    }
+
+    std::size_t capacity_;
+    double load_factor_;
+    std::size_t bucket_count_ = 0;
+    std::uint32_t seed_ = 0;
+    std::unique_ptr<Value[]> values_;
+    std::unique_ptr<Key[]> keys_;
+    std::unique_ptr<std::uint64_t[]> used_;
+    std::unique_ptr<LockPolicy> lock_;   /* Held by pointer so the table stays movable */
+};
+
+/*
+ * Primary table holding 90% of the capacity plus a secondary table for
+ * overflow, under one lock per operation. The low pointer bit selects the
+ * table, as in the C FixedTable.
+ */
+template <class Key, class Value, std::size_t BucketSize = 32, class LockPolicy = std::mutex>
+class FixedTable {
+    using Sub = SimpleTable<Key, Value, BucketSize, NullLock>;
+
+public:
+    using key_type = Key;
+    using value_type = Value;
+    static constexpr std::size_t bucket_size = BucketSize;
+    static constexpr unsigned pointer_bits = Sub::pointer_bits + 1;
+    using pointer = detail::uint_least<pointer_bits>;
+
+    explicit FixedTable(std::size_t total_capacity, double load_factor = 0.9)
+        : primary_(primary_capacity(total_capacity), load_factor),
+          secondary_(secondary_capacity(total_capacity), load_factor),
+          lock_(std::make_unique<LockPolicy>()) {}
+
+    FixedTable(FixedTable&&) noexcept = default;
+    FixedTable& operator=(FixedTable&&) noexcept = default;
+    FixedTable(const FixedTable&) = delete;
+    FixedTable& operator=(const FixedTable&) = delete;
+
+    std::optional<pointer> allocate(Key key, Value value) {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        if (auto tp = primary_.allocate(key, value))
+            return static_cast<pointer>(*tp << 1);
+        if (auto tp = secondary_.allocate(key, value))
+            return static_cast<pointer>((*tp << 1) | 1);
+        return std::nullopt;
+    }
+
+    Value dereference(Key key, pointer tp) const {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        return table_of(tp).dereference(key, static_cast<typename Sub::pointer>(tp >> 1));
+    }
+
+    void free(Key key, pointer tp) {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        (tp & 1 ? secondary_ : primary_).free(key, static_cast<typename Sub::pointer>(tp >> 1));
+    }
+
+    std::size_t size() const {
+        std::lock_guard<LockPolicy> guard(*lock_);
+        return primary_.size() + secondary_.size();
+    }
+
+private:
+    static std::size_t primary_capacity(std::size_t total_capacity) {
+        std::size_t capacity = static_cast<std::size_t>(total_capacity * 0.90);
+        return capacity ? capacity : 1;
+    }
+
+    static std::size_t secondary_capacity(std::size_t total_capacity) {
+        std::size_t primary = primary_capacity(total_capacity);
+        return total_capacity > primary ? total_capacity - primary : 1;
+    }
+
+    const Sub& table_of(pointer tp) const { return tp & 1 ? secondary_ : primary_; }
+
+    Sub primary_;
+    Sub secondary_;
+    std::unique_ptr<LockPolicy> lock_;
+};
+
+/*
+ * Containers of Levels sub-tables, each container under its own lock. The
+ * tiny pointer packs container, level and slot into
+ * container_bits + level_bits + slot bits, all fixed at compile time.
+ */
+template <class Key, class Value, std::size_t BucketSize = 32, std::size_t Levels = 4,
+          class LockPolicy = std::mutex>
+class VariableTable {
+    static_assert(Levels >= 1, "a container has at least one level");
+    using Sub = SimpleTable<Key, Value, BucketSize, NullLock>;
+
+public:
+    using key_type = Key;
+    using value_type = Value;
+    static constexpr std::size_t bucket_size = BucketSize;
+    static constexpr std::size_t level_count = Levels;
+    static constexpr unsigned slot_bits = Sub::pointer_bits;
+    static constexpr unsigned level_bits = detail::bits_for(Levels);
+    static constexpr unsigned container_bits = 8;
+    static constexpr std::size_t max_containers = std::size_t{1} << container_bits;
+    static constexpr unsigned pointer_bits = container_bits + level_bits + slot_bits;
+    using pointer = detail::uint_least<pointer_bits>;
+
+    VariableTable(std::size_t total_capacity, std::size_t container_capacity, double load_factor = 0.9) {
+        if (container_capacity == 0)
+            throw std::invalid_argument("tiny_ptr::VariableTable: container capacity is 0");
+        container_count_ = (total_capacity + container_capacity - 1) / container_capacity;
+        if (container_count_ == 0 || container_count_ > max_containers)
+            throw std::invalid_argument("tiny_ptr::VariableTable: 1..256 containers");
+        containers_.reset(new Container[container_count_]);
+        std::size_t level_capacity = container_capacity / Levels ? container_capacity / Levels : 1;
+        for (std::size_t c = 0; c < container_count_; c++) {
+            containers_[c].levels.reserve(Levels);
+            for (std::size_t level = 0; level < Levels; level++)
+                containers_[c].levels.emplace_back(level_capacity, load_factor);
+        }
+    }
+
+    VariableTable(VariableTable&&) noexcept = default;
+    VariableTable& operator=(VariableTable&&) noexcept = default;
+    VariableTable(const VariableTable&) = delete;
+    VariableTable& operator=(const VariableTable&) = delete;
+
+    std::optional<pointer> allocate(Key key, Value value) {
+        std::size_t c = container_of(key);
+        std::lock_guard<LockPolicy> guard(containers_[c].lock);
+        for (std::size_t level = 0; level < Levels; level++) {
+            if (auto tp = containers_[c].levels[level].allocate(key, value))
+                return encode(c, level, *tp);
+        }
+        return std::nullopt;
+    }
+
+    Value dereference(Key key, pointer tp) const {
+        Container& c = containers_[tp >> (level_bits + slot_bits)];
+        std::lock_guard<LockPolicy> guard(c.lock);
+        return c.levels[level_of(tp)].dereference(key, slot_of(tp));
+    }
+
+    void free(Key key, pointer tp) {
+        Container& c = containers_[tp >> (level_bits + slot_bits)];
+        std::lock_guard<LockPolicy> guard(c.lock);
+        c.levels[level_of(tp)].free(key, slot_of(tp));
+    }
+
+    std::size_t container_count() const noexcept { return container_count_; }
+
+private:
+    struct Container {
+        LockPolicy lock;
+        std::vector<Sub> levels;
+    };
+
+    /* Multiply-shift reduction onto [0, container_count) */
+    std::size_t container_of(Key key) const noexcept {
+        std::uint64_t h = detail::hash(detail::key_bits(key), 0);
+        return static_cast<std::size_t>((h * container_count_) >> 32);
+    }
+
+    static pointer encode(std::size_t c, std::size_t level, typename Sub::pointer slot) {
+        return static_cast<pointer>((c << (level_bits + slot_bits)) | (level << slot_bits) | slot);
+    }
+
+    static std::size_t level_of(pointer tp) noexcept {
+        return (tp >> slot_bits) & ((std::size_t{1} << level_bits) - 1);
+    }
+
+    static typename Sub::pointer slot_of(pointer tp) noexcept {
+        return static_cast<typename Sub::pointer>(tp & ((std::size_t{1} << slot_bits) - 1));
+    }
+
+    std::size_t container_count_ = 0;
+    std::unique_ptr<Container[]> containers_;
+};
+
+}  // namespace tiny_ptr
+
+#endif /* TINY_PTR_HPP */
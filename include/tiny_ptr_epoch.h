@@ -0,0 +1,32 @@
+#ifndef TINY_PTR_EPOCH_H
+#define TINY_PTR_EPOCH_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque type for an epoch-based reclamation domain */
+typedef struct EpochDomain EpochDomain;
+
+/* Create an EpochDomain */
+EpochDomain* epoch_create(void);
+
+/* Destroy an EpochDomain (no reader may be inside it) */
+void epoch_destroy(EpochDomain *ed);
+
+/* Enter a read-side critical section; returns a ticket for epoch_exit */
+int epoch_enter(EpochDomain *ed);
+
+/* Leave the read-side critical section identified by ticket */
+void epoch_exit(EpochDomain *ed, int ticket);
+
+/* Wait until every reader that entered before this call has exited */
+void epoch_synchronize(EpochDomain *ed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_EPOCH_H */
@@ -1,32 +1,76 @@
-#ifndef TINY_PTR_FIXED_H
-#define TINY_PTR_FIXED_H
-
-#include <stddef.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/* Opaque type for FixedTable */
-typedef struct FixedTable FixedTable;
-
-/* Create a FixedTable with given total capacity and load factor */
-FixedTable* fixed_create(size_t total_capacity, double load_factor);
-
-/* Destroy a FixedTable */
-void fixed_destroy(FixedTable *ft);
-
-/* Allocate an entry in a FixedTable */
-int fixed_allocate(FixedTable *ft, int key, int value);
-
-/* Dereference an entry in a FixedTable */
-int fixed_dereference(FixedTable *ft, int key, int tiny_ptr);
-
-/* Free an entry in a FixedTable */
-void fixed_free(FixedTable *ft, int key, int tiny_ptr);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* TINY_PTR_FIXED_H */
+#ifndef TINY_PTR_FIXED_H
+#define TINY_PTR_FIXED_H
+
+#include <stddef.h>
+#include "tiny_ptr_simple.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque type for FixedTable */
+typedef struct FixedTable FixedTable;
+
+/* Create a FixedTable with given total capacity and load factor */
+FixedTable* fixed_create(size_t total_capacity, double load_factor);
+
+/* FixedTable whose primary table takes primary_fraction (0..1) of the capacity; fixed_create uses 0.90 */
+FixedTable* fixed_create_ex(size_t total_capacity, double load_factor, double primary_fraction);
+
+/* Destroy a FixedTable */
+void fixed_destroy(FixedTable *ft);
+
+/* Allocate an entry in a FixedTable (lock-free) */
+int fixed_allocate(FixedTable *ft, int key, int value);
+
+/* Dereference an entry in a FixedTable (lock-free, one atomic load) */
+int fixed_dereference(FixedTable *ft, int key, int tiny_ptr);
+
+/* Free an entry in a FixedTable (lock-free) */
+void fixed_free(FixedTable *ft, int key, int tiny_ptr);
+
+/* Tiny pointers of up to max entries stored under key (primary first); returns how many were written */
+size_t fixed_find(FixedTable *ft, int key, int *out_tiny_ptrs, size_t max);
+
+/* Cursor over the live entries of a FixedTable: primary buckets, then secondary ones */
+typedef struct {
+    SimpleCursor primary;
+    SimpleCursor secondary;
+} FixedCursor;
+
+/*
+ * Cursor over the part-th of parts ranges of ft; the parts together cover
+ * both tables. The scan is lock-free and weakly consistent (see
+ * SimpleCursor); allocate publishes a slot only after storing its key and
+ * value, so an entry is reported only once both are in place.
+ */
+void fixed_cursor_init(FixedTable *ft, FixedCursor *cur, size_t part, size_t parts);
+
+/* Next live entry; returns 1 and fills key, value and tiny_ptr (each may be NULL), or 0 at the end */
+int fixed_cursor_next(FixedTable *ft, FixedCursor *cur, int *key, int *value, int *tiny_ptr);
+
+/* Bulk-insert n pairs; out_tiny_ptrs[i] is -1 where both tables overflowed. Returns pairs placed.
+   Bulk load, compact and freeze must not run concurrently with allocate/free. */
+size_t fixed_bulk_load(FixedTable *ft, const int *keys, const int *values, size_t n,
+                       int *out_tiny_ptrs, int nthreads);
+
+/* Smallest FixedTable that holds the live entries of ft, or NULL if none is smaller; ft is left intact */
+FixedTable* fixed_compact(FixedTable *ft, tiny_ptr_remap_fn remap, void *ctx);
+
+/* Bytes held by ft and its two tables */
+size_t fixed_memory_usage(const FixedTable *ft);
+
+/* Read-only packed image of ft (malloc'd, position independent); size in *out_size */
+void* fixed_freeze(FixedTable *ft, size_t *out_size);
+
+/* 0 if the image at image (8-byte aligned) fills exactly size bytes and is well formed, else -1 */
+int fixed_frozen_check(const void *image, size_t size);
+
+/* Dereference against an image produced by fixed_freeze; takes no locks */
+int fixed_frozen_dereference(const void *image, int key, int tiny_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_FIXED_H */
@@ -0,0 +1,49 @@
+#ifndef TINY_PTR_FROZEN_H
+#define TINY_PTR_FROZEN_H
+
+#include <stddef.h>
+#include "tiny_ptr_unified.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Opaque type for a frozen table: an immutable, densely packed copy of a
+ * table that answers dereferences with no locks and no keys stored. Tiny
+ * pointers issued by the source table stay valid against it. The image is
+ * position independent, so it can be saved and mapped back from a file.
+ */
+typedef struct tiny_ptr_frozen_t tiny_ptr_frozen_t;
+
+/* Freeze the current contents of table (which stays usable). Returns NULL on failure. */
+tiny_ptr_frozen_t* tiny_ptr_freeze(tiny_ptr_table_t* table);
+
+/*
+ * Wrap an image produced by tiny_ptr_frozen_data without copying; data must
+ * be 8-byte aligned and outlive the result. Opening and loading check every
+ * offset and count in the image against its size and return NULL for a
+ * truncated or corrupt image.
+ */
+tiny_ptr_frozen_t* tiny_ptr_frozen_open(const void* data, size_t size);
+
+/* Map a file written by tiny_ptr_frozen_save read-only. Returns NULL on failure. */
+tiny_ptr_frozen_t* tiny_ptr_frozen_load(const char* path);
+
+/* Write the image to path. Returns 0 on success, -1 on failure. */
+int tiny_ptr_frozen_save(const tiny_ptr_frozen_t* frozen, const char* path);
+
+/* The raw image and its size in bytes */
+const void* tiny_ptr_frozen_data(const tiny_ptr_frozen_t* frozen, size_t* out_size);
+
+/* Dereference a tiny pointer; returns 0 for a slot that was free when frozen */
+int tiny_ptr_frozen_dereference(const tiny_ptr_frozen_t* frozen, int key, int tiny_ptr);
+
+/* Release a frozen table (unmaps it if it was loaded from a file) */
+void tiny_ptr_frozen_destroy(tiny_ptr_frozen_t* frozen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_FROZEN_H */
@@ -0,0 +1,69 @@
+#ifndef TINY_PTR_LIST_H
+#define TINY_PTR_LIST_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Opaque type for a TinyList: a singly linked list of ints whose nodes hold
+ * a two-byte link to their successor instead of a 64-bit address: a tiny
+ * pointer and the successor's key as a hop from the node's own. Insert and
+ * erase never move a node. A TinyList is not synchronized; callers
+ * serialize access, as with std::list.
+ */
+typedef struct TinyList TinyList;
+
+/* A node: the key it was allocated under and its tiny pointer (-1 past the end) */
+typedef struct {
+    int key;
+    int tiny_ptr;
+} TinyListPos;
+
+/*
+ * Create a TinyList sized for capacity nodes. The list rebuilds its table
+ * when it fills up, or when tens of thousands of inserts pile up in one
+ * spot; rebuilding invalidates positions held by the caller, so size the
+ * list up front to keep them stable.
+ */
+TinyList* tiny_list_create(size_t capacity, double load_factor);
+
+/* Destroy a TinyList */
+void tiny_list_destroy(TinyList *list);
+
+/* Add value at either end; returns 0, or -1 if the list could not grow */
+int tiny_list_push_front(TinyList *list, int value);
+int tiny_list_push_back(TinyList *list, int value);
+
+/* Remove the first node, storing its value in *value; returns 0, or -1 if the list is empty */
+int tiny_list_pop_front(TinyList *list, int *value);
+
+/* Link value after pos (or tiny_list_before_begin); the new node's position goes to *out */
+int tiny_list_insert_after(TinyList *list, TinyListPos pos, int value, TinyListPos *out);
+
+/* Unlink the node after pos; returns 0, or -1 if pos is the last node */
+int tiny_list_erase_after(TinyList *list, TinyListPos pos);
+
+/* Position before the first node, for insert_after/erase_after at the front */
+TinyListPos tiny_list_before_begin(const TinyList *list);
+
+/* First node, and the node after pos; tiny_ptr is -1 past the end */
+TinyListPos tiny_list_begin(const TinyList *list);
+TinyListPos tiny_list_next(const TinyList *list, TinyListPos pos);
+
+/* Value stored at pos */
+int tiny_list_value(const TinyList *list, TinyListPos pos);
+
+/* Number of nodes */
+size_t tiny_list_size(const TinyList *list);
+
+/* Bytes held by the list */
+size_t tiny_list_memory_usage(const TinyList *list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_LIST_H */
@@ -0,0 +1,45 @@
+#ifndef TINY_PTR_MAP_H
+#define TINY_PTR_MAP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Opaque type for a TinyMap: an int -> int dictionary with unique keys.
+ * The entry of a key lives in that key's SimpleTable bucket and is found
+ * by the SIMD key scan, so the map stores no pointer at all, not even a
+ * tiny one. Keys whose bucket is full go to a small stash, and the tables
+ * double once the stash overflows too. A TinyMap is not synchronized;
+ * callers serialize access, as with std::unordered_map.
+ */
+typedef struct TinyMap TinyMap;
+
+/* Create a TinyMap sized for capacity entries at the given load factor */
+TinyMap* tiny_map_create(size_t capacity, double load_factor);
+
+/* Destroy a TinyMap */
+void tiny_map_destroy(TinyMap *map);
+
+/* Insert key or overwrite its value; returns 0, or -1 if the table could not grow */
+int tiny_map_put(TinyMap *map, int key, int value);
+
+/* Store key's value in *value; returns 0, or -1 if key is absent */
+int tiny_map_get(TinyMap *map, int key, int *value);
+
+/* Remove key; returns 0, or -1 if key is absent */
+int tiny_map_erase(TinyMap *map, int key);
+
+/* Number of entries */
+size_t tiny_map_size(const TinyMap *map);
+
+/* Bytes held by the map */
+size_t tiny_map_memory_usage(const TinyMap *map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_MAP_H */
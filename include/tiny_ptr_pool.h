@@ -0,0 +1,44 @@
+#ifndef TINY_PTR_POOL_H
+#define TINY_PTR_POOL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Opaque type for a TinyPool: a slab of fixed-size objects addressed by
+ * tiny pointers. Slots are claimed through the bucket masks of a mask-only
+ * SimpleTable (no key or value arrays), and the object of slot i lives at
+ * slab + i * stride, so the pool keeps one mask bit per object and callers
+ * keep no full-width pointer.
+ */
+typedef struct TinyPool TinyPool;
+
+/* Create a pool for capacity objects of object_size bytes (objects are 16-byte aligned) */
+TinyPool* tiny_pool_create(size_t capacity, size_t object_size, double load_factor);
+
+/* Destroy a TinyPool and its slab */
+void tiny_pool_destroy(TinyPool *pool);
+
+/* Claim a zeroed object for key (lock-free); returns its tiny pointer, or -1 if key's bucket is full */
+int tiny_pool_alloc(TinyPool *pool, int key);
+
+/* Address of the object behind (key, tiny_ptr), or NULL if tiny_ptr is out of range */
+void* tiny_pool_deref(TinyPool *pool, int key, int tiny_ptr);
+
+/* Release the object behind (key, tiny_ptr) (lock-free) */
+void tiny_pool_free(TinyPool *pool, int key, int tiny_ptr);
+
+/* Number of live objects */
+size_t tiny_pool_live_count(const TinyPool *pool);
+
+/* Bytes between consecutive objects in the slab */
+size_t tiny_pool_stride(const TinyPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_POOL_H */
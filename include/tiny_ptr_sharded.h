@@ -0,0 +1,105 @@
+#ifndef TINY_PTR_SHARDED_H
+#define TINY_PTR_SHARDED_H
+
+#include <stddef.h>
+#include "tiny_ptr_simple.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque type for ShardedTable */
+typedef struct ShardedTable ShardedTable;
+
+/*
+ * Create a ShardedTable of shard_count independent SimpleTables (rounded up
+ * to a power of two; 0 picks one shard per online CPU).
+ *
+ * Shards are not bound to NUMA nodes, deliberately: there is no node hint
+ * and no mbind call. Table pages are committed on first write, so each
+ * page lands on the node of the thread that first touches it, and a shard
+ * rebuilt by sharded_resize_shard from a thread on a given node is placed
+ * on that node. Callers that want pinned shards run their writers (or the
+ * resize) on the intended node.
+ */
+ShardedTable* sharded_create(size_t total_capacity, size_t shard_count, double load_factor);
+
+/* Shard count sharded_create uses when given 0: the number of online CPUs */
+size_t sharded_default_shard_count(void);
+
+/* Destroy a ShardedTable */
+void sharded_destroy(ShardedTable *sh);
+
+/* Allocate an entry in a ShardedTable */
+int sharded_allocate(ShardedTable *sh, int key, int value);
+
+/* Dereference an entry in a ShardedTable */
+int sharded_dereference(ShardedTable *sh, int key, int tiny_ptr);
+
+/* Free an entry in a ShardedTable */
+void sharded_free(ShardedTable *sh, int key, int tiny_ptr);
+
+/* Tiny pointers of up to max entries stored under key; returns how many were written */
+size_t sharded_find(ShardedTable *sh, int key, int *out_tiny_ptrs, size_t max);
+
+/* Number of shards */
+size_t sharded_shard_count(const ShardedTable *sh);
+
+/* Shard that owns key (selected by the high bits of the key's hash) */
+size_t sharded_shard_of(const ShardedTable *sh, int key);
+
+/* Resize one shard; only that shard's allocate/free wait for it. Returns 0, or -1 (also while a cursor is inside). */
+int sharded_resize_shard(ShardedTable *sh, size_t shard, size_t new_capacity, int nthreads);
+
+/* Resize every shard, one at a time, to new_total_capacity / shard_count. Returns 0 on success. */
+int sharded_resize(ShardedTable *sh, size_t new_total_capacity, int nthreads);
+
+/* Cursor over the live entries of a ShardedTable, shard by shard */
+typedef struct {
+    size_t shard;        /* Shard being scanned */
+    size_t end_unit;     /* One past the end of the range; each shard spans parts units */
+    size_t begin_unit;
+    size_t parts;
+    SimpleTable *table;  /* Table of the shard being scanned, or NULL between shards */
+    SimpleCursor inner;
+} ShardedCursor;
+
+/*
+ * Cursor over the part-th of parts ranges of sh; each shard is cut into
+ * parts equal bucket ranges, so parts > shard_count still balances. While
+ * the cursor is inside a shard, resizing that shard fails and compaction
+ * skips it; no lock is held between calls. Within a shard the scan is
+ * weakly consistent (see SimpleCursor).
+ */
+void sharded_cursor_init(ShardedTable *sh, ShardedCursor *cur, size_t part, size_t parts);
+
+/* Next live entry; returns 1 and fills key, value and tiny_ptr (each may be NULL), or 0 at the end */
+int sharded_cursor_next(ShardedTable *sh, ShardedCursor *cur, int *key, int *value, int *tiny_ptr);
+
+/* Leave the shard of an unfinished cursor (from any thread); harmless after the end */
+void sharded_cursor_close(ShardedTable *sh, ShardedCursor *cur);
+
+/* Bulk-insert n pairs; out_tiny_ptrs[i] is -1 where a bucket overflowed. Returns pairs placed. */
+size_t sharded_bulk_load(ShardedTable *sh, const int *keys, const int *values, size_t n,
+                         int *out_tiny_ptrs, int nthreads);
+
+/* Shrink every shard to the smallest table that holds its live entries. Returns 0 on success. */
+int sharded_compact(ShardedTable *sh, tiny_ptr_remap_fn remap, void *ctx);
+
+/* Bytes held by sh and its shard tables */
+size_t sharded_memory_usage(ShardedTable *sh);
+
+/* Read-only packed image of sh (malloc'd, position independent); size in *out_size */
+void* sharded_freeze(ShardedTable *sh, size_t *out_size);
+
+/* 0 if the image at image (8-byte aligned) fills exactly size bytes and is well formed, else -1 */
+int sharded_frozen_check(const void *image, size_t size);
+
+/* Dereference against an image produced by sharded_freeze; takes no locks */
+int sharded_frozen_dereference(const void *image, int key, int tiny_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_SHARDED_H */
@@ -1,29 +1,198 @@
-#ifndef TINY_PTR_SIMPLE_H
-#define TINY_PTR_SIMPLE_H
-
-#include <stddef.h>
-#include <stdint.h>
-#include <pthread.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-typedef struct SimpleTable SimpleTable;
-
-/* Extended creation: accepts a load factor */
-SimpleTable* simple_create_ex(size_t capacity, double load_factor);
-void simple_destroy(SimpleTable* st);
-int simple_allocate(SimpleTable* st, int key, int value);
-int simple_dereference(SimpleTable* st, int key, int tiny_ptr);
-void simple_free(SimpleTable* st, int key, int tiny_ptr);
-SimpleTable* simple_resize(SimpleTable* st, size_t new_capacity);
-
-/* Alias for legacy code: simple_create calls simple_create_ex with a default load factor */
-SimpleTable* simple_create(size_t capacity);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* TINY_PTR_SIMPLE_H */
+#ifndef TINY_PTR_SIMPLE_H
+#define TINY_PTR_SIMPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SimpleTable SimpleTable;
+
+/* Layout of a table; two tables with equal geometry give every key the same bucket */
+typedef struct {
+    size_t capacity;        /* Requested capacity */
+    double load_factor;
+    size_t bucket_count;
+    size_t bucket_size;
+    uint32_t hash_seed;
+} SimpleGeometry;
+
+/* Instruction set level picked at load time for the hot kernels */
+typedef enum {
+    TINY_PTR_SIMD_GENERIC,
+    TINY_PTR_SIMD_SSE42,   /* x86-64-v2 */
+    TINY_PTR_SIMD_AVX2,    /* x86-64-v3 */
+    TINY_PTR_SIMD_AVX512   /* x86-64-v4 */
+} TinyPtrSimdLevel;
+
+/* Called with the key, value and tiny pointer of each live entry */
+typedef void (*simple_visit_fn)(void *ctx, int key, int value, int tiny_ptr);
+
+/* Called for every entry whose tiny pointer changed during a compaction */
+typedef void (*tiny_ptr_remap_fn)(void *ctx, int key, int old_tiny_ptr, int new_tiny_ptr);
+
+/* Extended creation: accepts a load factor */
+SimpleTable* simple_create_ex(size_t capacity, double load_factor);
+
+/* Creation with an explicit bucket size of 1..64 slots (0 derives it from capacity) */
+SimpleTable* simple_create_sized(size_t capacity, double load_factor, size_t bucket_size);
+void simple_destroy(SimpleTable* st);
+int simple_allocate(SimpleTable* st, int key, int value);
+int simple_dereference(SimpleTable* st, int key, int tiny_ptr);
+void simple_free(SimpleTable* st, int key, int tiny_ptr);
+
+/* Same operations without taking st's lock; the caller serializes access to st */
+int simple_allocate_unlocked(SimpleTable* st, int key, int value);
+int simple_dereference_unlocked(SimpleTable* st, int key, int tiny_ptr);
+void simple_free_unlocked(SimpleTable* st, int key, int tiny_ptr);
+
+/* Table for the lock-free writers below: keeps a claim mask per bucket next to the occupancy mask */
+SimpleTable* simple_create_lock_free(size_t capacity, double load_factor);
+
+/*
+ * Lock-free allocate/free on a table from simple_create_lock_free (others
+ * get -1). A slot is claimed with a CAS and becomes visible to find,
+ * lookup and cursors only once its key and value are stored.
+ */
+int simple_allocate_atomic(SimpleTable* st, int key, int value);
+void simple_free_atomic(SimpleTable* st, int key, int tiny_ptr);
+
+/* Mark every occupied slot as claimed, after the locked writers (e.g. bulk load) filled a lock-free table */
+void simple_sync_claims(SimpleTable* st);
+
+/*
+ * Occupancy-only table: bucket masks without key or value arrays, for
+ * callers that keep their own storage per slot (see tiny_pool). Only
+ * claim/release, slot index, geometry, live count, memory usage and
+ * destroy apply to it.
+ */
+SimpleTable* simple_create_mask_only(size_t capacity, double load_factor);
+
+/* Claim a free slot of key's bucket by setting its mask bit alone (lock-free); returns the tiny pointer or -1 */
+int simple_claim_slot(SimpleTable* st, int key);
+
+/* Clear the mask bit of (key, tiny_ptr) (lock-free) */
+void simple_release_slot(SimpleTable* st, int key, int tiny_ptr);
+
+/* Tiny pointers of up to max live slots holding key (SIMD bucket scan); returns how many were written */
+size_t simple_find(SimpleTable* st, int key, int* out_tiny_ptrs, size_t max);
+size_t simple_find_unlocked(SimpleTable* st, int key, int* out_tiny_ptrs, size_t max);
+
+/* Value of the first live slot holding key in *value; returns its tiny pointer, or -1 if key is absent */
+int simple_lookup_unlocked(SimpleTable* st, int key, int* value);
+
+/* Dereference n pairs at once into out[0..n); returns 0 on success */
+int simple_dereference_batch(SimpleTable* st, const int* keys, const int* tiny_ptrs, size_t n, int* out);
+
+/* Same without taking st's lock (atomic loads); safe alongside the locked writers */
+int simple_dereference_batch_unlocked(SimpleTable* st, const int* keys, const int* tiny_ptrs, size_t n, int* out);
+SimpleTable* simple_resize(SimpleTable* st, size_t new_capacity);
+
+/* Resize with the rehash split across nthreads worker threads */
+SimpleTable* simple_resize_parallel(SimpleTable* st, size_t new_capacity, int nthreads);
+
+/* Resized copy that leaves the source table alive (for deferred reclamation) */
+SimpleTable* simple_rehash(SimpleTable* st, size_t new_capacity);
+SimpleTable* simple_rehash_parallel(SimpleTable* st, size_t new_capacity, int nthreads);
+
+/* Insert n pairs at once; out_tiny_ptrs[i] is -1 where a bucket overflowed. Returns pairs placed. */
+size_t simple_bulk_load(SimpleTable* st, const int* keys, const int* values, size_t n,
+                        int* out_tiny_ptrs, int nthreads);
+
+/* Number of allocated entries */
+size_t simple_live_count(const SimpleTable* st);
+
+/* Bytes held by the table: the struct, the key and value arrays and the bucket masks */
+size_t simple_memory_usage(const SimpleTable* st);
+
+/* Fill *out with the table's layout; returns 0 on success */
+int simple_geometry(const SimpleTable* st, SimpleGeometry* out);
+
+/* Position of (key, tiny_ptr) in the table's flat slot arrays, in [0, bucket_count * bucket_size) */
+size_t simple_slot_index(const SimpleTable* st, int key, int tiny_ptr);
+
+/* Store an entry at a given tiny pointer; returns -1 if that slot is occupied */
+int simple_insert_at(SimpleTable* st, int key, int value, int tiny_ptr);
+
+/* Call fn for every allocated entry; the caller must keep allocate/free off st meanwhile */
+void simple_visit(SimpleTable* st, simple_visit_fn fn, void* ctx);
+
+/*
+ * Cursor over a range of buckets. Empty buckets are skipped through the
+ * occupancy masks, so a scan costs time in proportion to the live entries
+ * (plus one mask word per bucket). Each bucket is copied into the cursor
+ * at once, then handed out one entry at a time. Scans are weakly
+ * consistent. An entry that stays live for the whole scan is reported
+ * exactly once. An entry allocated or freed during the scan may or may not
+ * be reported. Cursors over disjoint ranges may run in parallel.
+ */
+typedef struct {
+    size_t bucket;       /* Next bucket to read */
+    size_t end_bucket;   /* One past the last bucket of the range */
+    uint64_t pending;    /* Slots of the copied bucket not yet returned */
+    int keys[64];        /* Copied bucket, indexed by slot */
+    int values[64];
+} SimpleCursor;
+
+/* Cursor over buckets [begin_bucket, end_bucket) (clamped to the table) */
+void simple_cursor_init(const SimpleTable* st, SimpleCursor* cur, size_t begin_bucket, size_t end_bucket);
+
+/* Cursor over the part-th of parts equal bucket ranges; the parts together cover the table */
+void simple_cursor_part(const SimpleTable* st, SimpleCursor* cur, size_t part, size_t parts);
+
+/* Next live entry; returns 1 and fills key, value and tiny_ptr (each may be NULL), or 0 at the end */
+int simple_cursor_next(SimpleTable* st, SimpleCursor* cur, int* key, int* value, int* tiny_ptr);
+
+/* Same without taking st's lock; still safe alongside the lock-free allocate/free */
+int simple_cursor_next_unlocked(SimpleTable* st, SimpleCursor* cur, int* key, int* value, int* tiny_ptr);
+
+/* Copy the next occupied bucket into cur unless entries are pending; returns 0 at the end (no lock) */
+int simple_cursor_fill(SimpleTable* st, SimpleCursor* cur);
+
+/* Smallest table that holds the live entries of st, or NULL if none is smaller; st is left intact */
+SimpleTable* simple_compact(SimpleTable* st, tiny_ptr_remap_fn remap, void* ctx);
+
+/* Read-only packed image of st (malloc'd, position independent); size in *out_size */
+void* simple_freeze(SimpleTable* st, size_t* out_size);
+
+/* Size of the well-formed image at image (8-byte aligned) within size bytes, or 0 if it is malformed */
+size_t simple_frozen_check(const void* image, size_t size);
+
+/* Dereference against an image produced by simple_freeze; takes no locks */
+int simple_frozen_dereference(const void* image, int key, int tiny_ptr);
+
+/*
+ * Process-shared tables: the table lives in a POSIX shared memory object
+ * (or an anonymous memfd when name is NULL) and is guarded by a
+ * process-shared mutex, so every attached process sees the same entries.
+ * simple_destroy only detaches the calling process; the geometry is fixed,
+ * so simple_resize returns NULL for a shared table.
+ */
+SimpleTable* simple_create_shared(const char* name, size_t capacity, double load_factor);
+SimpleTable* simple_attach_shared(const char* name);
+
+/* Attach through a descriptor of the region (e.g. an inherited memfd); takes ownership of fd */
+SimpleTable* simple_attach_shared_fd(int fd);
+
+/* Descriptor of a shared table's region, or -1 for a private table */
+int simple_shared_fd(const SimpleTable* st);
+int simple_is_shared(const SimpleTable* st);
+
+/* Remove the name of a shared object; attached processes keep their mappings */
+int simple_unlink_shared(const char* name);
+
+/* Kernel variant the CPU dispatch selected, and a printable name for it */
+TinyPtrSimdLevel simple_simd_level(void);
+const char* simple_simd_level_name(TinyPtrSimdLevel level);
+
+/* Alias for legacy code: simple_create calls simple_create_ex with a default load factor */
+SimpleTable* simple_create(size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_SIMPLE_H */
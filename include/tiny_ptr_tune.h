@@ -0,0 +1,45 @@
+#ifndef TINY_PTR_TUNE_H
+#define TINY_PTR_TUNE_H
+
+#include <stddef.h>
+#include "tiny_ptr_unified.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One step of a recorded workload */
+typedef struct {
+    int key;
+    int is_free;  /* 0: allocate under key; otherwise free the latest live allocation of key */
+} TinyPtrOp;
+
+/* How the chosen configuration fared in simulation */
+typedef struct {
+    size_t allocations;
+    size_t failures;        /* Allocations that found no free slot */
+    size_t memory_bytes;    /* tiny_ptr_memory_usage of the simulated table */
+    size_t candidates;      /* Configurations simulated */
+} TinyPtrTuneReport;
+
+/*
+ * Pick the configuration of variant that uses the least memory while at
+ * most target_failure of the allocations fail. Each candidate is built as a
+ * real table (same hash functions and seeds) sized for the workload's peak
+ * live count, and the workload is replayed against it. The estimate cannot
+ * resolve probabilities below 1 / allocations, so pass a representative
+ * sample. Returns 0 and fills *config (and *report if non-NULL), or -1 if
+ * no candidate meets the target or a free has no matching allocation.
+ */
+int tiny_ptr_tune_workload(TinyPtrVariant variant, const TinyPtrOp *ops, size_t n,
+                           double target_failure, TinyPtrConfig *config, TinyPtrTuneReport *report);
+
+/* Same for an insert-only workload: every key in keys is allocated once, in order */
+int tiny_ptr_tune(TinyPtrVariant variant, const int *keys, size_t n, double target_failure,
+                  TinyPtrConfig *config, TinyPtrTuneReport *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_TUNE_H */
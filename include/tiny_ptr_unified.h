@@ -1,33 +1,124 @@
-#ifndef TINY_PTR_H
-#define TINY_PTR_H
-
-#include <stddef.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-typedef enum {
-    TINY_PTR_SIMPLE,
-    TINY_PTR_FIXED,
-    TINY_PTR_VARIABLE
-} TinyPtrVariant;
-
-typedef struct tiny_ptr_table_t {
-    TinyPtrVariant variant;
-    void* table;  // For the simple variant, this points to a SimpleTable.
-} tiny_ptr_table_t;
-
-/* Unified interface */
-tiny_ptr_table_t* tiny_ptr_create(size_t capacity, TinyPtrVariant variant, double load_factor);
-int tiny_ptr_allocate(tiny_ptr_table_t* table, int key, int value);
-int tiny_ptr_dereference(tiny_ptr_table_t* table, int key, int tiny_ptr);
-void tiny_ptr_free(tiny_ptr_table_t* table, int key, int tiny_ptr);
-int tiny_ptr_resize(tiny_ptr_table_t** table, size_t new_capacity);
-void tiny_ptr_destroy(tiny_ptr_table_t* table);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* TINY_PTR_H */
+#ifndef TINY_PTR_H
+#define TINY_PTR_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "tiny_ptr_epoch.h"
+#include "tiny_ptr_simple.h"
+#include "tiny_ptr_fixed.h"
+#include "tiny_ptr_variable.h"
+#include "tiny_ptr_sharded.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    TINY_PTR_SIMPLE,
+    TINY_PTR_FIXED,
+    TINY_PTR_VARIABLE,
+    TINY_PTR_SHARDED
+} TinyPtrVariant;
+
+typedef struct tiny_ptr_table_t {
+    TinyPtrVariant variant;
+    void* table;  // For the simple variant, this points to a SimpleTable.
+    EpochDomain* epoch;            // Dereferences pin the current table inside an epoch.
+    pthread_rwlock_t resize_lock;  // Shared by allocate/free, exclusive while resizing.
+    int open_cursors;              // Resize and compact fail while any cursor is open.
+} tiny_ptr_table_t;
+
+/* Layout parameters tiny_ptr_create fills in when none are given */
+#define TINY_PTR_DEFAULT_PRIMARY_FRACTION 0.90
+#define TINY_PTR_DEFAULT_CONTAINERS 4
+#define TINY_PTR_DEFAULT_LEVELS 4
+
+/* Every layout choice of a table; fields a variant does not use are ignored */
+typedef struct {
+    TinyPtrVariant variant;
+    size_t capacity;
+    double load_factor;        /* SIMPLE, FIXED, SHARDED */
+    size_t bucket_size;        /* SIMPLE: 1..64 slots, or 0 to derive it from capacity */
+    double primary_fraction;   /* FIXED: share of the capacity in the primary table */
+    size_t container_capacity; /* VARIABLE */
+    size_t level_count;        /* VARIABLE: 1..16 */
+    size_t shard_count;        /* SHARDED: rounded up to a power of two, or 0 for one per online CPU */
+} TinyPtrConfig;
+
+/* Unified interface */
+tiny_ptr_table_t* tiny_ptr_create(size_t capacity, TinyPtrVariant variant, double load_factor);
+int tiny_ptr_allocate(tiny_ptr_table_t* table, int key, int value);
+int tiny_ptr_dereference(tiny_ptr_table_t* table, int key, int tiny_ptr);
+void tiny_ptr_free(tiny_ptr_table_t* table, int key, int tiny_ptr);
+int tiny_ptr_dereference_batch(tiny_ptr_table_t* table, const int* keys, const int* tiny_ptrs,
+                               size_t n, int* out);
+size_t tiny_ptr_find(tiny_ptr_table_t* table, int key, int* out_tiny_ptrs, size_t max);
+int tiny_ptr_resize(tiny_ptr_table_t** table, size_t new_capacity);
+int tiny_ptr_resize_parallel(tiny_ptr_table_t** table, size_t new_capacity, int nthreads);
+int tiny_ptr_compact(tiny_ptr_table_t* table, tiny_ptr_remap_fn remap, void* ctx);
+void tiny_ptr_destroy(tiny_ptr_table_t* table);
+
+/* Cursor over the live entries of a table; see tiny_ptr_cursor_open */
+typedef struct {
+    tiny_ptr_table_t* table;
+    union {
+        SimpleCursor simple;
+        FixedCursor fixed;
+        VariableCursor variable;
+        ShardedCursor sharded;
+    } u;
+} TinyPtrCursor;
+
+/*
+ * Open a cursor over the part-th of parts ranges of the table; the parts
+ * together cover it, so parts threads can each scan one. Empty buckets are
+ * skipped through the occupancy masks. The scan is weakly consistent: an
+ * entry live from open to close is reported exactly once, and an entry
+ * allocated or freed meanwhile may or may not be. Allocate/free/dereference
+ * proceed during the scan. No lock is held between calls, so a cursor may
+ * be advanced and closed from any thread. Resize and compact fail with -1
+ * while a cursor is open (for SHARDED, while one is inside the shard)
+ * instead of moving entries under it. Parts opened one after another may
+ * straddle a resize, which can move an entry from one part to another;
+ * keep all parts open at once for a single snapshot of the layout.
+ * Returns 0, or -1 on invalid arguments.
+ */
+int tiny_ptr_cursor_open(tiny_ptr_table_t* table, TinyPtrCursor* cur, size_t part, size_t parts);
+
+/* Next live entry; returns 1 and fills key, value and tiny_ptr (each may be NULL), or 0 at the end */
+int tiny_ptr_cursor_next(TinyPtrCursor* cur, int* key, int* value, int* tiny_ptr);
+
+/* Close a cursor opened by tiny_ptr_cursor_open, finished or not; every open cursor must be closed */
+void tiny_ptr_cursor_close(TinyPtrCursor* cur);
+
+/* Fill *config with the layout tiny_ptr_create would use; returns 0 on success */
+int tiny_ptr_default_config(size_t capacity, TinyPtrVariant variant, double load_factor,
+                            TinyPtrConfig* config);
+
+/* Create a table with an explicit layout (e.g. one chosen by tiny_ptr_tune) */
+tiny_ptr_table_t* tiny_ptr_create_config(const TinyPtrConfig* config);
+
+/* Bytes held by the table */
+size_t tiny_ptr_memory_usage(tiny_ptr_table_t* table);
+
+/* Instruction set level of the dispatched kernels (see simple_simd_level_name) */
+TinyPtrSimdLevel tiny_ptr_simd_level(void);
+
+/* Build a table from n key/value pairs at once; out_tiny_ptrs[i] receives the tiny pointer of pair i */
+tiny_ptr_table_t* tiny_ptr_bulk_build(TinyPtrVariant variant, const int* keys, const int* values,
+                                      size_t n, int* out_tiny_ptrs, int nthreads);
+
+/*
+ * SIMPLE table in POSIX shared memory, visible to every process that attaches
+ * to name (or, with name NULL, to an anonymous memfd passed by descriptor).
+ * tiny_ptr_destroy detaches; shared tables cannot be resized or compacted.
+ */
+tiny_ptr_table_t* tiny_ptr_create_shared(const char* name, size_t capacity, double load_factor);
+tiny_ptr_table_t* tiny_ptr_attach_shared(const char* name);
+tiny_ptr_table_t* tiny_ptr_attach_shared_fd(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_H */
@@ -1,32 +1,72 @@
-#ifndef TINY_PTR_VARIABLE_H
-#define TINY_PTR_VARIABLE_H
-
-#include <stddef.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/* Opaque type for VariableTable */
-typedef struct VariableTable VariableTable;
-
-/* Create a VariableTable with total_capacity, container_capacity, and level_count */
-VariableTable* variable_create(size_t total_capacity, size_t container_capacity, size_t level_count);
-
-/* Destroy a VariableTable */
-void variable_destroy(VariableTable *vt);
-
-/* Allocate an entry in a VariableTable */
-int variable_allocate(VariableTable *vt, int key, int value);
-
-/* Dereference an entry in a VariableTable */
-int variable_dereference(VariableTable *vt, int key, int tiny_ptr);
-
-/* Free an entry in a VariableTable */
-void variable_free(VariableTable *vt, int key, int tiny_ptr);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* TINY_PTR_VARIABLE_H */
+#ifndef TINY_PTR_VARIABLE_H
+#define TINY_PTR_VARIABLE_H
+
+#include <stddef.h>
+#include "tiny_ptr_simple.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque type for VariableTable */
+typedef struct VariableTable VariableTable;
+
+/* Create a VariableTable with total_capacity, container_capacity, and level_count */
+VariableTable* variable_create(size_t total_capacity, size_t container_capacity, size_t level_count);
+
+/* Destroy a VariableTable */
+void variable_destroy(VariableTable *vt);
+
+/* Allocate an entry in a VariableTable */
+int variable_allocate(VariableTable *vt, int key, int value);
+
+/* Dereference an entry in a VariableTable */
+int variable_dereference(VariableTable *vt, int key, int tiny_ptr);
+
+/* Free an entry in a VariableTable */
+void variable_free(VariableTable *vt, int key, int tiny_ptr);
+
+/* Tiny pointers of up to max entries stored under key (level order); returns how many were written */
+size_t variable_find(VariableTable *vt, int key, int *out_tiny_ptrs, size_t max);
+
+/* Cursor over the live entries of a VariableTable, container by container and level by level */
+typedef struct {
+    size_t table;        /* container * level_count + level of the table being scanned */
+    size_t end_bucket;   /* One past the last bucket of the range, counted across all tables */
+    SimpleCursor inner;
+} VariableCursor;
+
+/* Cursor over the part-th of parts ranges of vt; the parts together cover every level of every container */
+void variable_cursor_init(VariableTable *vt, VariableCursor *cur, size_t part, size_t parts);
+
+/*
+ * Next live entry; returns 1 and fills key, value and tiny_ptr (each may be
+ * NULL), or 0 at the end. The container lock is held only while a bucket is
+ * copied, so the scan is weakly consistent (see SimpleCursor).
+ */
+int variable_cursor_next(VariableTable *vt, VariableCursor *cur, int *key, int *value, int *tiny_ptr);
+
+/* Bulk-insert n pairs; out_tiny_ptrs[i] is -1 where every level overflowed. Returns pairs placed. */
+size_t variable_bulk_load(VariableTable *vt, const int *keys, const int *values, size_t n,
+                          int *out_tiny_ptrs, int nthreads);
+
+/* Smallest VariableTable that holds the live entries of vt, or NULL if none is smaller; vt is left intact */
+VariableTable* variable_compact(VariableTable *vt, tiny_ptr_remap_fn remap, void *ctx);
+
+/* Bytes held by vt and all of its level tables */
+size_t variable_memory_usage(const VariableTable *vt);
+
+/* Read-only packed image of vt (malloc'd, position independent); size in *out_size */
+void* variable_freeze(VariableTable *vt, size_t *out_size);
+
+/* 0 if the image at image (8-byte aligned) fills exactly size bytes and is well formed, else -1 */
+int variable_frozen_check(const void *image, size_t size);
+
+/* Dereference against an image produced by variable_freeze; takes no locks */
+int variable_frozen_dereference(const void *image, int key, int tiny_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINY_PTR_VARIABLE_H */
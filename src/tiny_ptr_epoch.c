@@ -0,0 +1,90 @@
+#include "tiny_ptr_epoch.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define EPOCH_STRIPES 16
+#define EPOCH_CACHE_LINE 64
+
+/*
+ * Readers are counted per epoch parity. Counters are striped across
+ * cache lines so that readers on different threads do not bounce a
+ * single line between cores.
+ */
+typedef struct {
+    unsigned long readers[2];
+    char pad[EPOCH_CACHE_LINE - 2 * sizeof(unsigned long)];
+} EpochStripe;
+
+struct EpochDomain {
+    EpochStripe stripes[EPOCH_STRIPES];
+    unsigned long epoch;
+    char pad[EPOCH_CACHE_LINE - sizeof(unsigned long)];
+    pthread_mutex_t sync_mutex;   /* Serializes epoch_synchronize callers */
+};
+
+static unsigned int next_stripe = 0;
+static __thread int thread_stripe = -1;
+
+// Returns the stripe used by the calling thread, assigning one round-robin on first use.
+static inline int current_stripe(void) {
+    if (thread_stripe < 0)
+        thread_stripe = (int)(__atomic_fetch_add(&next_stripe, 1, __ATOMIC_RELAXED) % EPOCH_STRIPES);
+    return thread_stripe;
+}
+
+EpochDomain* epoch_create(void) {
+    EpochDomain *ed = NULL;
+    if (posix_memalign((void **)&ed, EPOCH_CACHE_LINE, sizeof(EpochDomain)) != 0)
+        return NULL;
+    for (int s = 0; s < EPOCH_STRIPES; s++) {
+        ed->stripes[s].readers[0] = 0;
+        ed->stripes[s].readers[1] = 0;
+    }
+    ed->epoch = 0;
+    pthread_mutex_init(&ed->sync_mutex, NULL);
+    return ed;
+}
+
+void epoch_destroy(EpochDomain *ed) {
+    if (!ed) return;
+    pthread_mutex_destroy(&ed->sync_mutex);
+    free(ed);
+}
+
+/*
+ * A reader registers under the parity of the current epoch and then
+ * re-checks the epoch. If a synchronize flipped it in between, the
+ * registration may have been missed, so the reader backs off and retries.
+ */
+int epoch_enter(EpochDomain *ed) {
+    int s = current_stripe();
+    for (;;) {
+        unsigned long e = __atomic_load_n(&ed->epoch, __ATOMIC_SEQ_CST);
+        int parity = (int)(e & 1);
+        __atomic_fetch_add(&ed->stripes[s].readers[parity], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ed->epoch, __ATOMIC_SEQ_CST) == e)
+            return (s << 1) | parity;
+        __atomic_fetch_sub(&ed->stripes[s].readers[parity], 1, __ATOMIC_RELEASE);
+    }
+}
+
+void epoch_exit(EpochDomain *ed, int ticket) {
+    __atomic_fetch_sub(&ed->stripes[ticket >> 1].readers[ticket & 1], 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Flips the epoch so new readers register under the other parity, then
+ * waits for the readers of the old parity to drain. Anything unpublished
+ * before this call is unreachable once it returns.
+ */
+void epoch_synchronize(EpochDomain *ed) {
+    pthread_mutex_lock(&ed->sync_mutex);
+    unsigned long e = __atomic_fetch_add(&ed->epoch, 1, __ATOMIC_SEQ_CST);
+    int parity = (int)(e & 1);
+    for (int s = 0; s < EPOCH_STRIPES; s++) {
+        while (__atomic_load_n(&ed->stripes[s].readers[parity], __ATOMIC_SEQ_CST) != 0)
+            sched_yield();
+    }
+    pthread_mutex_unlock(&ed->sync_mutex);
+}
@@ -1,84 +1,293 @@
-#include "tiny_ptr_fixed.h"
-#include "tiny_ptr_simple.h"
-#include <stdlib.h>
-#include <stdio.h>
-#include <pthread.h>
-
-struct FixedTable {
-    SimpleTable *primary;
-    SimpleTable *secondary;
-    size_t primary_capacity;
-    size_t secondary_capacity;
-    pthread_mutex_t mutex;
-};
-
-FixedTable* fixed_create(size_t total_capacity, double load_factor) {
-    FixedTable *ft = malloc(sizeof(FixedTable));
-    if (!ft) return NULL;
-    ft->primary_capacity = (size_t)(total_capacity * 0.90);
-    ft->secondary_capacity = total_capacity - ft->primary_capacity;
-    ft->primary = simple_create(ft->primary_capacity);
-    ft->secondary = simple_create(ft->secondary_capacity);
-    if (!ft->primary || !ft->secondary) {
-        simple_destroy(ft->primary);
-        simple_destroy(ft->secondary);
-        free(ft);
-        return NULL;
-    }
-    pthread_mutex_init(&ft->mutex, NULL);
-    return ft;
-}
-
-void fixed_destroy(FixedTable *ft) {
-    if (!ft) return;
-    pthread_mutex_destroy(&ft->mutex);
-    simple_destroy(ft->primary);
-    simple_destroy(ft->secondary);
-    free(ft);
-}
-
-int fixed_allocate(FixedTable *ft, int key, int value) {
-    if (!ft) return -1;
-    pthread_mutex_lock(&ft->mutex);
-    int tp = simple_allocate(ft->primary, key, value);
-    int encoded;
-    if (tp != -1) {
-        encoded = (tp << 1) | 0;  /* flag 0 indicates primary table */
-        pthread_mutex_unlock(&ft->mutex);
-        return encoded;
-    }
-    tp = simple_allocate(ft->secondary, key, value);
-    if (tp != -1) {
-        encoded = (tp << 1) | 1;  /* flag 1 indicates secondary table */
-        pthread_mutex_unlock(&ft->mutex);
-        return encoded;
-    }
-    pthread_mutex_unlock(&ft->mutex);
-    return -1;
-}
-
-int fixed_dereference(FixedTable *ft, int key, int tiny_ptr) {
-    if (!ft) return -1;
-    int flag = tiny_ptr & 1;
-    int offset = tiny_ptr >> 1;
-    int ret;
-    pthread_mutex_lock(&ft->mutex);
-    if (flag == 0)
-        ret = simple_dereference(ft->primary, key, offset);
-    else
-        ret = simple_dereference(ft->secondary, key, offset);
-    pthread_mutex_unlock(&ft->mutex);
-    return ret;
-}
-
-void fixed_free(FixedTable *ft, int key, int tiny_ptr) {
-    if (!ft) return;
-    int flag = tiny_ptr & 1;
-    int offset = tiny_ptr >> 1;
-    pthread_mutex_lock(&ft->mutex);
-    if (flag == 0)
-        simple_free(ft->primary, key, offset);
-    else
-        simple_free(ft->secondary, key, offset);
-    pthread_mutex_unlock(&ft->mutex);
-}
+#include "tiny_ptr_fixed.h"
+#include "tiny_ptr_simple.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * FixedTable takes no locks: allocate and free claim and release slots with
+ * a CAS on the sub-tables' bucket masks, and dereference is a single atomic
+ * load. Bulk load, compaction and freezing must not overlap allocate/free
+ * (the unified layer holds them off).
+ */
+/* Share of the capacity given to the primary table by fixed_create */
+#define FIXED_PRIMARY_FRACTION 0.90
+
+struct FixedTable {
+    SimpleTable *primary;
+    SimpleTable *secondary;
+    size_t primary_capacity;
+    size_t secondary_capacity;
+    double load_factor;
+    double primary_fraction;
+};
+
+FixedTable* fixed_create(size_t total_capacity, double load_factor) {
+    return fixed_create_ex(total_capacity, load_factor, FIXED_PRIMARY_FRACTION);
+}
+
+FixedTable* fixed_create_ex(size_t total_capacity, double load_factor, double primary_fraction) {
+    if (primary_fraction <= 0.0 || primary_fraction >= 1.0) return NULL;
+    FixedTable *ft = malloc(sizeof(FixedTable));
+    if (!ft) return NULL;
+    ft->primary_capacity = (size_t)(total_capacity * primary_fraction);
+    ft->secondary_capacity = total_capacity - ft->primary_capacity;
+    ft->load_factor = load_factor;
+    ft->primary_fraction = primary_fraction;
+    ft->primary = simple_create_lock_free(ft->primary_capacity, load_factor);
+    ft->secondary = simple_create_lock_free(ft->secondary_capacity, load_factor);
+    if (!ft->primary || !ft->secondary) {
+        simple_destroy(ft->primary);
+        simple_destroy(ft->secondary);
+        free(ft);
+        return NULL;
+    }
+    return ft;
+}
+
+void fixed_destroy(FixedTable *ft) {
+    if (!ft) return;
+    simple_destroy(ft->primary);
+    simple_destroy(ft->secondary);
+    free(ft);
+}
+
+int fixed_allocate(FixedTable *ft, int key, int value) {
+    if (!ft) return -1;
+    int tp = simple_allocate_atomic(ft->primary, key, value);
+    if (tp != -1)
+        return (tp << 1) | 0;  /* flag 0 indicates primary table */
+    tp = simple_allocate_atomic(ft->secondary, key, value);
+    if (tp != -1)
+        return (tp << 1) | 1;  /* flag 1 indicates secondary table */
+    return -1;
+}
+
+int fixed_dereference(FixedTable *ft, int key, int tiny_ptr) {
+    if (!ft) return -1;
+    int flag = tiny_ptr & 1;
+    int offset = tiny_ptr >> 1;
+    return simple_dereference_unlocked(flag == 0 ? ft->primary : ft->secondary, key, offset);
+}
+
+void fixed_free(FixedTable *ft, int key, int tiny_ptr) {
+    if (!ft) return;
+    int flag = tiny_ptr & 1;
+    int offset = tiny_ptr >> 1;
+    simple_free_atomic(flag == 0 ? ft->primary : ft->secondary, key, offset);
+}
+
+/*
+ * fixed_find searches the primary table, then the secondary one. It runs
+ * lock-free alongside allocate/free: an allocation in flight becomes
+ * visible only once its key is stored, so every reported tiny pointer held
+ * key at the time of the scan. An entry allocated or freed meanwhile may
+ * or may not be reported.
+ */
+size_t fixed_find(FixedTable *ft, int key, int *out_tiny_ptrs, size_t max) {
+    if (!ft || (max > 0 && !out_tiny_ptrs)) return 0;
+    size_t found = simple_find_unlocked(ft->primary, key, out_tiny_ptrs, max);
+    for (size_t i = 0; i < found; i++)
+        out_tiny_ptrs[i] <<= 1;  /* flag 0 indicates primary table */
+    size_t more = simple_find_unlocked(ft->secondary, key, out_tiny_ptrs + found, max - found);
+    for (size_t i = found; i < found + more; i++)
+        out_tiny_ptrs[i] = (out_tiny_ptrs[i] << 1) | 1;  /* flag 1 indicates secondary table */
+    return found + more;
+}
+
+/*
+ * The cursor numbers the buckets of both tables in one sequence (primary
+ * first) and cuts that sequence into parts, so a split scan balances even
+ * though the secondary table is much smaller.
+ */
+void fixed_cursor_init(FixedTable *ft, FixedCursor *cur, size_t part, size_t parts) {
+    if (!cur) return;
+    SimpleGeometry pg = {0}, sg = {0};
+    if (ft) {
+        simple_geometry(ft->primary, &pg);
+        simple_geometry(ft->secondary, &sg);
+    }
+    size_t total = pg.bucket_count + sg.bucket_count;
+    size_t begin = total, end = total;
+    if (parts > 0 && part < parts) {
+        begin = total / parts * part + total % parts * part / parts;
+        end = total / parts * (part + 1) + total % parts * (part + 1) / parts;
+    }
+    SimpleTable *primary = ft ? ft->primary : NULL;
+    SimpleTable *secondary = ft ? ft->secondary : NULL;
+    simple_cursor_init(primary, &cur->primary, begin, end);
+    simple_cursor_init(secondary, &cur->secondary,
+                       begin > pg.bucket_count ? begin - pg.bucket_count : 0,
+                       end > pg.bucket_count ? end - pg.bucket_count : 0);
+}
+
+int fixed_cursor_next(FixedTable *ft, FixedCursor *cur, int *key, int *value, int *tiny_ptr) {
+    if (!ft || !cur) return 0;
+    int tp;
+    if (simple_cursor_next_unlocked(ft->primary, &cur->primary, key, value, &tp)) {
+        if (tiny_ptr) *tiny_ptr = (tp << 1) | 0;  /* flag 0 indicates primary table */
+        return 1;
+    }
+    if (simple_cursor_next_unlocked(ft->secondary, &cur->secondary, key, value, &tp)) {
+        if (tiny_ptr) *tiny_ptr = (tp << 1) | 1;  /* flag 1 indicates secondary table */
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * fixed_bulk_load fills the primary table first and sends only the pairs
+ * whose primary bucket overflowed on to the secondary table.
+ */
+size_t fixed_bulk_load(FixedTable *ft, const int *keys, const int *values, size_t n,
+                       int *out_tiny_ptrs, int nthreads) {
+    if (!ft || n == 0 || !keys || !values || !out_tiny_ptrs) return 0;
+    size_t placed = simple_bulk_load(ft->primary, keys, values, n, out_tiny_ptrs, nthreads);
+    for (size_t i = 0; i < n; i++) {
+        if (out_tiny_ptrs[i] != -1)
+            out_tiny_ptrs[i] <<= 1;  /* flag 0 indicates primary table */
+    }
+    size_t overflow = n - placed;
+    if (overflow > 0) {
+        size_t *idx = malloc(overflow * sizeof(size_t));
+        int *okeys = malloc(overflow * sizeof(int));
+        int *ovalues = malloc(overflow * sizeof(int));
+        int *otps = malloc(overflow * sizeof(int));
+        if (idx && okeys && ovalues && otps) {
+            size_t m = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (out_tiny_ptrs[i] == -1) {
+                    idx[m] = i;
+                    okeys[m] = keys[i];
+                    ovalues[m] = values[i];
+                    m++;
+                }
+            }
+            placed += simple_bulk_load(ft->secondary, okeys, ovalues, m, otps, nthreads);
+            for (size_t j = 0; j < m; j++)
+                out_tiny_ptrs[idx[j]] = otps[j] == -1 ? -1 : (otps[j] << 1) | 1;
+        }
+        free(idx); free(okeys); free(ovalues); free(otps);
+    }
+    simple_sync_claims(ft->primary);
+    simple_sync_claims(ft->secondary);
+    return placed;
+}
+
+typedef struct {
+    int key;
+    int value;
+    int tiny_ptr;
+} FixedEntry;
+
+typedef struct {
+    FixedEntry *entries;
+    size_t count;
+    int flag;   /* Sub-table flag folded into the collected tiny pointers */
+} FixedCollector;
+
+static void collect_fixed_entry(void *ctx, int key, int value, int tiny_ptr) {
+    FixedCollector *c = ctx;
+    c->entries[c->count++] = (FixedEntry){ key, value, (tiny_ptr << 1) | c->flag };
+}
+
+/*
+ * fixed_compact rebuilds ft at the smallest total capacity that holds its
+ * live entries, growing 25% per attempt on overflow. Returns the new table,
+ * or NULL if no smaller table fits; ft is left intact. The caller must keep
+ * allocate/free off ft meanwhile.
+ */
+FixedTable* fixed_compact(FixedTable *ft, tiny_ptr_remap_fn remap, void *ctx) {
+    if (!ft) return NULL;
+    size_t old_capacity = ft->primary_capacity + ft->secondary_capacity;
+    size_t live = simple_live_count(ft->primary) + simple_live_count(ft->secondary);
+    FixedCollector collector = { malloc((live ? live : 1) * sizeof(FixedEntry)), 0, 0 };
+    int *new_tps = malloc((live ? live : 1) * sizeof(int));
+    if (!collector.entries || !new_tps) {
+        free(collector.entries); free(new_tps);
+        return NULL;
+    }
+    simple_visit(ft->primary, collect_fixed_entry, &collector);
+    collector.flag = 1;
+    simple_visit(ft->secondary, collect_fixed_entry, &collector);
+
+    FixedTable *new_ft = NULL;
+    /* Both sub-tables need at least one slot */
+    size_t target = live > 2 ? live : 2;
+    while (target < old_capacity) {
+        new_ft = fixed_create_ex(target, ft->load_factor, ft->primary_fraction);
+        if (!new_ft) break;
+        size_t i;
+        for (i = 0; i < live; i++) {
+            new_tps[i] = fixed_allocate(new_ft, collector.entries[i].key, collector.entries[i].value);
+            if (new_tps[i] == -1) break;
+        }
+        if (i == live) break;
+        fixed_destroy(new_ft);
+        new_ft = NULL;
+        target += target / 4 + 1;
+    }
+    if (new_ft && remap) {
+        for (size_t i = 0; i < live; i++) {
+            if (new_tps[i] != collector.entries[i].tiny_ptr)
+                remap(ctx, collector.entries[i].key, collector.entries[i].tiny_ptr, new_tps[i]);
+        }
+    }
+    free(collector.entries);
+    free(new_tps);
+    return new_ft;
+}
+
+size_t fixed_memory_usage(const FixedTable *ft) {
+    if (!ft) return 0;
+    return sizeof(FixedTable) + simple_memory_usage(ft->primary) + simple_memory_usage(ft->secondary);
+}
+
+/* Frozen FixedTable: this header followed by the primary and secondary images */
+typedef struct {
+    uint64_t primary_offset;
+    uint64_t secondary_offset;
+} FrozenFixedHeader;
+
+void* fixed_freeze(FixedTable *ft, size_t *out_size) {
+    if (!ft || !out_size) return NULL;
+    size_t primary_size, secondary_size;
+    void *primary = simple_freeze(ft->primary, &primary_size);
+    void *secondary = simple_freeze(ft->secondary, &secondary_size);
+    size_t size = sizeof(FrozenFixedHeader) + primary_size + secondary_size;
+    unsigned char *image = (primary && secondary) ? malloc(size) : NULL;
+    if (image) {
+        FrozenFixedHeader *h = (FrozenFixedHeader *)image;
+        h->primary_offset = sizeof(FrozenFixedHeader);
+        h->secondary_offset = h->primary_offset + primary_size;
+        memcpy(image + h->primary_offset, primary, primary_size);
+        memcpy(image + h->secondary_offset, secondary, secondary_size);
+        *out_size = size;
+    }
+    free(primary);
+    free(secondary);
+    return image;
+}
+
+int fixed_frozen_check(const void *image, size_t size) {
+    if (!image || size < sizeof(FrozenFixedHeader)) return -1;
+    const FrozenFixedHeader *h = image;
+    if (h->primary_offset != sizeof(FrozenFixedHeader) || h->secondary_offset < h->primary_offset ||
+        h->secondary_offset > size || h->secondary_offset % 8 != 0)
+        return -1;
+    const unsigned char *base = image;
+    size_t primary_size = (size_t)(h->secondary_offset - h->primary_offset);
+    size_t secondary_size = size - (size_t)h->secondary_offset;
+    if (simple_frozen_check(base + h->primary_offset, primary_size) != primary_size ||
+        simple_frozen_check(base + h->secondary_offset, secondary_size) != secondary_size)
+        return -1;
+    return 0;
+}
+
+int fixed_frozen_dereference(const void *image, int key, int tiny_ptr) {
+    if (!image) return -1;
+    const FrozenFixedHeader *h = image;
+    uint64_t offset = (tiny_ptr & 1) ? h->secondary_offset : h->primary_offset;
+    return simple_frozen_dereference((const unsigned char *)image + offset, key, tiny_ptr >> 1);
+}
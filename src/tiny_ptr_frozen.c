@@ -0,0 +1,184 @@
+#include "tiny_ptr_frozen.h"
+#include "tiny_ptr_simple.h"
+#include "tiny_ptr_fixed.h"
+#include "tiny_ptr_variable.h"
+#include "tiny_ptr_sharded.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define FROZEN_MAGIC 0x5a52465054504954ULL  /* "TIPTPFRZ" */
+#define FROZEN_VERSION 2
+
+/*
+ * Every frozen table starts with this header; the variant's own image
+ * follows immediately. Images are stored in native byte order.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t variant;
+    uint64_t total_size;
+} FrozenHeader;
+
+typedef enum {
+    FROZEN_BORROWED,  /* Caller owns the bytes (tiny_ptr_frozen_open) */
+    FROZEN_MALLOCED,  /* Built by tiny_ptr_freeze */
+    FROZEN_MAPPED     /* Mapped by tiny_ptr_frozen_load */
+} FrozenOwnership;
+
+struct tiny_ptr_frozen_t {
+    const unsigned char* base;  /* FrozenHeader */
+    size_t size;
+    TinyPtrVariant variant;
+    const void* image;          /* Variant image, just past the header */
+    FrozenOwnership ownership;
+};
+
+/* Whether the variant image of size bytes is well formed, down to every offset and count inside it */
+static int frozen_check(TinyPtrVariant variant, const void* image, size_t size) {
+    switch (variant) {
+        case TINY_PTR_SIMPLE:
+            return simple_frozen_check(image, size) == size ? 0 : -1;
+        case TINY_PTR_FIXED:
+            return fixed_frozen_check(image, size);
+        case TINY_PTR_VARIABLE:
+            return variable_frozen_check(image, size);
+        case TINY_PTR_SHARDED:
+            return sharded_frozen_check(image, size);
+    }
+    return -1;
+}
+
+static tiny_ptr_frozen_t* frozen_wrap(const void* data, size_t size, FrozenOwnership ownership) {
+    if (!data || size < sizeof(FrozenHeader) || (uintptr_t) data % 8 != 0) return NULL;
+    const FrozenHeader* h = data;
+    if (h->magic != FROZEN_MAGIC || h->version != FROZEN_VERSION || h->total_size != size ||
+        h->variant > TINY_PTR_SHARDED)
+        return NULL;
+    if (frozen_check((TinyPtrVariant) h->variant, (const unsigned char*) data + sizeof(FrozenHeader),
+                     size - sizeof(FrozenHeader)) != 0)
+        return NULL;
+    tiny_ptr_frozen_t* frozen = malloc(sizeof(tiny_ptr_frozen_t));
+    if (!frozen) return NULL;
+    frozen->base = data;
+    frozen->size = size;
+    frozen->variant = (TinyPtrVariant) h->variant;
+    frozen->image = (const unsigned char*) data + sizeof(FrozenHeader);
+    frozen->ownership = ownership;
+    return frozen;
+}
+
+/*
+ * Allocate/free are held off while the variant is frozen so the image is a
+ * consistent snapshot; dereferences keep running. Sharded tables freeze
+ * shard by shard under their own locks.
+ */
+tiny_ptr_frozen_t* tiny_ptr_freeze(tiny_ptr_table_t* ut) {
+    if (!ut) return NULL;
+    size_t image_size = 0;
+    void* image;
+    if (ut->variant == TINY_PTR_SHARDED) {
+        image = sharded_freeze((ShardedTable*) ut->table, &image_size);
+    } else {
+        pthread_rwlock_wrlock(&ut->resize_lock);
+        switch (ut->variant) {
+            case TINY_PTR_SIMPLE:
+                image = simple_freeze((SimpleTable*) ut->table, &image_size);
+                break;
+            case TINY_PTR_FIXED:
+                image = fixed_freeze((struct FixedTable*) ut->table, &image_size);
+                break;
+            case TINY_PTR_VARIABLE:
+                image = variable_freeze((struct VariableTable*) ut->table, &image_size);
+                break;
+            default:
+                image = NULL;
+        }
+        pthread_rwlock_unlock(&ut->resize_lock);
+    }
+    if (!image) return NULL;
+    size_t size = sizeof(FrozenHeader) + image_size;
+    unsigned char* data = malloc(size);
+    if (!data) {
+        free(image);
+        return NULL;
+    }
+    FrozenHeader* h = (FrozenHeader*) data;
+    h->magic = FROZEN_MAGIC;
+    h->version = FROZEN_VERSION;
+    h->variant = (uint32_t) ut->variant;
+    h->total_size = size;
+    memcpy(data + sizeof(FrozenHeader), image, image_size);
+    free(image);
+    tiny_ptr_frozen_t* frozen = frozen_wrap(data, size, FROZEN_MALLOCED);
+    if (!frozen) free(data);
+    return frozen;
+}
+
+/* The whole image is validated once here, so dereferences need no bounds checks. */
+tiny_ptr_frozen_t* tiny_ptr_frozen_open(const void* data, size_t size) {
+    return frozen_wrap(data, size, FROZEN_BORROWED);
+}
+
+tiny_ptr_frozen_t* tiny_ptr_frozen_load(const char* path) {
+    if (!path) return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < (off_t) sizeof(FrozenHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t) sb.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    tiny_ptr_frozen_t* frozen = frozen_wrap(data, size, FROZEN_MAPPED);
+    if (!frozen) munmap(data, size);
+    return frozen;
+}
+
+int tiny_ptr_frozen_save(const tiny_ptr_frozen_t* frozen, const char* path) {
+    if (!frozen || !path) return -1;
+    FILE* f = fopen(path, "wb");
+    if (!f) return -1;
+    size_t written = fwrite(frozen->base, 1, frozen->size, f);
+    if (fclose(f) != 0 || written != frozen->size) return -1;
+    return 0;
+}
+
+const void* tiny_ptr_frozen_data(const tiny_ptr_frozen_t* frozen, size_t* out_size) {
+    if (!frozen) return NULL;
+    if (out_size) *out_size = frozen->size;
+    return frozen->base;
+}
+
+int tiny_ptr_frozen_dereference(const tiny_ptr_frozen_t* frozen, int key, int tiny_ptr) {
+    if (!frozen) return -1;
+    switch (frozen->variant) {
+        case TINY_PTR_SIMPLE:
+            return simple_frozen_dereference(frozen->image, key, tiny_ptr);
+        case TINY_PTR_FIXED:
+            return fixed_frozen_dereference(frozen->image, key, tiny_ptr);
+        case TINY_PTR_VARIABLE:
+            return variable_frozen_dereference(frozen->image, key, tiny_ptr);
+        case TINY_PTR_SHARDED:
+            return sharded_frozen_dereference(frozen->image, key, tiny_ptr);
+    }
+    return -1;
+}
+
+void tiny_ptr_frozen_destroy(tiny_ptr_frozen_t* frozen) {
+    if (!frozen) return;
+    if (frozen->ownership == FROZEN_MALLOCED)
+        free((void*) frozen->base);
+    else if (frozen->ownership == FROZEN_MAPPED)
+        munmap((void*) frozen->base, frozen->size);
+    free(frozen);
+}
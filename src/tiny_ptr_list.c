@@ -0,0 +1,322 @@
+#include "tiny_ptr_list.h"
+#include "tiny_ptr_simple.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+/* links[] value of the last node */
+#define LIST_END 0xFFFF
+
+/* Tiny pointer of the before-begin position */
+#define LIST_BEFORE_BEGIN (-2)
+
+/* Keys tried (each hashing to another bucket) before the list counts as crowded */
+#define LIST_KEY_ATTEMPTS 64
+
+/* Doublings tried before an insert gives up */
+#define LIST_GROW_ATTEMPTS 4
+
+/*
+ * A node is allocated in the nodes table under a key within max_hop of its
+ * predecessor's, and the predecessor's 16-bit link holds the node's tiny
+ * pointer under the difference, so a node's key is derived from its
+ * predecessor's and never stored: the nodes table keeps bucket masks only,
+ * and values live in a parallel array indexed by slot. Keys need not be unique: a newcomer takes its predecessor's
+ * key until that bucket is half full, which packs runs of neighbours into
+ * one bucket. Erasing hands the erased node's link back to its predecessor;
+ * when the two hops together span more than a link can, the erased node
+ * stays allocated as a dead relay until a later erase lets it go or the list
+ * is rebuilt. No live node ever moves.
+ */
+struct TinyList {
+    SimpleTable *nodes;   /* Mask-only slot table, keyed within a hop of the predecessor */
+    int *values;          /* Per slot: the node's value */
+    size_t bucket_size;
+    int ptr_bits;         /* Low link bits holding the tiny pointer */
+    int max_hop;          /* Largest key difference a link spans; the top hop code is LIST_END's */
+    uint16_t *links;      /* Per slot: key hop and tiny pointer of the successor, or LIST_END */
+    uint8_t *dead;        /* Per slot bit: erased node still relaying its link */
+    size_t slots;
+    size_t capacity;
+    double load_factor;
+    int head_key;         /* Key of the first node; the before-begin link never hops */
+    uint16_t head_link;
+    TinyListPos tail;     /* Last node, or before-begin when the list is empty */
+    size_t size;
+};
+
+static int list_init(TinyList *list, size_t capacity, double load_factor) {
+    list->nodes = simple_create_mask_only(capacity, load_factor);
+    SimpleGeometry g;
+    if (!list->nodes || simple_geometry(list->nodes, &g) != 0) {
+        simple_destroy(list->nodes);
+        return -1;
+    }
+    list->slots = g.bucket_count * g.bucket_size;
+    list->bucket_size = g.bucket_size;
+    list->ptr_bits = 0;
+    while (((size_t)1 << list->ptr_bits) < g.bucket_size)
+        list->ptr_bits++;
+    list->max_hop = (1 << (15 - list->ptr_bits)) - 1;
+    list->values = malloc(list->slots * sizeof(int));
+    list->links = malloc(list->slots * sizeof(uint16_t));
+    list->dead = calloc((list->slots + 7) / 8, 1);
+    if (!list->values || !list->links || !list->dead) {
+        free(list->values);
+        free(list->links);
+        free(list->dead);
+        simple_destroy(list->nodes);
+        return -1;
+    }
+    list->capacity = capacity;
+    list->load_factor = load_factor;
+    list->head_key = 0;
+    list->head_link = LIST_END;
+    list->tail.key = 0;
+    list->tail.tiny_ptr = LIST_BEFORE_BEGIN;
+    list->size = 0;
+    return 0;
+}
+
+static void list_release(TinyList *list) {
+    free(list->values);
+    free(list->links);
+    free(list->dead);
+    simple_destroy(list->nodes);
+}
+
+TinyList* tiny_list_create(size_t capacity, double load_factor) {
+    TinyList *list = malloc(sizeof(TinyList));
+    if (!list) return NULL;
+    if (list_init(list, capacity, load_factor) != 0) {
+        free(list);
+        return NULL;
+    }
+    return list;
+}
+
+void tiny_list_destroy(TinyList *list) {
+    if (!list) return;
+    list_release(list);
+    free(list);
+}
+
+/* Whether a link at from can reach a node under key; before-begin reaches any key */
+static int in_reach(const TinyList *list, TinyListPos from, int key) {
+    return from.tiny_ptr == LIST_BEFORE_BEGIN || abs(key - from.key) <= list->max_hop;
+}
+
+/* Points the link at from to next (tiny_ptr -1 for the end) */
+static void set_link(TinyList *list, TinyListPos from, TinyListPos next) {
+    uint16_t link = LIST_END;
+    if (from.tiny_ptr == LIST_BEFORE_BEGIN) {
+        if (next.tiny_ptr >= 0) {
+            list->head_key = next.key;
+            link = (uint16_t)((list->max_hop << list->ptr_bits) | next.tiny_ptr);
+        }
+        list->head_link = link;
+        return;
+    }
+    if (next.tiny_ptr >= 0)
+        link = (uint16_t)(((next.key - from.key + list->max_hop) << list->ptr_bits) | next.tiny_ptr);
+    list->links[simple_slot_index(list->nodes, from.key, from.tiny_ptr)] = link;
+}
+
+/* The node pos links to, dead or alive */
+static TinyListPos step(const TinyList *list, TinyListPos pos) {
+    TinyListPos next = {0, -1};
+    uint16_t link;
+    if (pos.tiny_ptr == LIST_BEFORE_BEGIN) {
+        pos.key = list->head_key;
+        link = list->head_link;
+    } else {
+        link = list->links[simple_slot_index(list->nodes, pos.key, pos.tiny_ptr)];
+    }
+    if (link != LIST_END) {
+        next.key = pos.key + (link >> list->ptr_bits) - list->max_hop;
+        next.tiny_ptr = link & ((1 << list->ptr_bits) - 1);
+    }
+    return next;
+}
+
+static int is_dead(const TinyList *list, TinyListPos pos) {
+    size_t i = simple_slot_index(list->nodes, pos.key, pos.tiny_ptr);
+    return (list->dead[i / 8] >> (i % 8)) & 1;
+}
+
+static void set_dead(TinyList *list, TinyListPos pos, int dead) {
+    size_t i = simple_slot_index(list->nodes, pos.key, pos.tiny_ptr);
+    if (dead)
+        list->dead[i / 8] |= (uint8_t)(1u << (i % 8));
+    else
+        list->dead[i / 8] &= (uint8_t)~(1u << (i % 8));
+}
+
+/* The next live node after pos */
+static TinyListPos successor(const TinyList *list, TinyListPos pos) {
+    do {
+        pos = step(list, pos);
+    } while (pos.tiny_ptr >= 0 && is_dead(list, pos));
+    return pos;
+}
+
+static int link_after(TinyList *list, TinyListPos pos, int value, TinyListPos *out) {
+    TinyListPos next = step(list, pos);
+    /* pos's key first, or the first node's when pushing to the front */
+    int key = pos.tiny_ptr != LIST_BEFORE_BEGIN ? pos.key : next.tiny_ptr >= 0 ? next.key : list->head_key;
+    /* Then keys spread over the window both neighbours reach, so inserts piling up in one spot find room */
+    int lo = key - list->max_hop, hi = key + list->max_hop;
+    /* An append past a half-full bucket moves on to the next key, leaving room for inserts */
+    if (next.tiny_ptr < 0 && (size_t)pos.tiny_ptr >= list->bucket_size / 2)
+        key++;
+    if (next.tiny_ptr >= 0) {
+        if (pos.tiny_ptr == LIST_BEFORE_BEGIN || next.key - list->max_hop > lo) lo = next.key - list->max_hop;
+        if (pos.tiny_ptr == LIST_BEFORE_BEGIN || next.key + list->max_hop < hi) hi = next.key + list->max_hop;
+    }
+    for (int n = 0; n < LIST_KEY_ATTEMPTS; n++) {
+        if (n > 0) {
+            uint32_t r = ((uint32_t)list->size * 0x9e3779b9u) ^ ((uint32_t)n * 0x85ebca6bu);
+            r ^= r >> 15;
+            key = lo + (int)(r % (uint32_t)(hi - lo + 1));
+        }
+        int tp = simple_claim_slot(list->nodes, key);
+        if (tp < 0) continue;
+        TinyListPos node = {key, tp};
+        list->values[simple_slot_index(list->nodes, key, tp)] = value;
+        set_link(list, node, next);
+        set_link(list, pos, node);
+        if (next.tiny_ptr < 0)
+            list->tail = node;
+        list->size++;
+        if (out) *out = node;
+        return 0;
+    }
+    return -1;
+}
+
+/* Frees the dead nodes after pos whose neighbours are close enough in key to link directly */
+static void prune_dead(TinyList *list, TinyListPos pos) {
+    if (successor(list, pos).tiny_ptr < 0) {
+        /* Only dead nodes follow: pos becomes the tail */
+        for (TinyListPos dead = step(list, pos); dead.tiny_ptr >= 0;) {
+            TinyListPos next = step(list, dead);
+            set_dead(list, dead, 0);
+            simple_release_slot(list->nodes, dead.key, dead.tiny_ptr);
+            dead = next;
+        }
+        TinyListPos end = {0, -1};
+        set_link(list, pos, end);
+        list->tail = pos;
+        return;
+    }
+    TinyListPos from = pos;
+    for (;;) {
+        TinyListPos dead = step(list, from);
+        if (dead.tiny_ptr < 0 || !is_dead(list, dead)) return;
+        TinyListPos next = step(list, dead);
+        if (!in_reach(list, from, next.key)) {
+            from = dead;
+            continue;
+        }
+        set_link(list, from, next);
+        set_dead(list, dead, 0);
+        simple_release_slot(list->nodes, dead.key, dead.tiny_ptr);
+    }
+}
+
+/*
+ * Rebuild the list with its keys spread out again, in a table twice as large
+ * when grow is set; *track is updated to its new position.
+ */
+static int list_rebuild(TinyList *list, TinyListPos *track, int grow) {
+    size_t capacity = list->capacity;
+    for (int attempt = 0; attempt < LIST_GROW_ATTEMPTS; attempt++) {
+        if (grow || attempt > 0)
+            capacity *= 2;
+        TinyList bigger;
+        if (list_init(&bigger, capacity, list->load_factor) != 0) return -1;
+        TinyListPos moved = tiny_list_before_begin(&bigger);
+        int ok = 1;
+        for (TinyListPos p = tiny_list_begin(list); p.tiny_ptr >= 0 && ok; p = successor(list, p)) {
+            TinyListPos q;
+            ok = link_after(&bigger, bigger.tail, tiny_list_value(list, p), &q) == 0;
+            if (ok && p.key == track->key && p.tiny_ptr == track->tiny_ptr)
+                moved = q;
+        }
+        if (!ok) {
+            list_release(&bigger);
+            continue;
+        }
+        list_release(list);
+        *list = bigger;
+        *track = moved;
+        return 0;
+    }
+    return -1;
+}
+
+int tiny_list_insert_after(TinyList *list, TinyListPos pos, int value, TinyListPos *out) {
+    if (!list || (pos.tiny_ptr < 0 && pos.tiny_ptr != LIST_BEFORE_BEGIN)) return -1;
+    for (int rebuilds = 0; link_after(list, pos, value, out) != 0; rebuilds++) {
+        /* Keys near pos are crowded: spread them out, and grow once that is not enough */
+        if (list_rebuild(list, &pos, rebuilds > 0 || list->size >= list->capacity / 2) != 0) return -1;
+    }
+    return 0;
+}
+
+int tiny_list_push_front(TinyList *list, int value) {
+    if (!list) return -1;
+    return tiny_list_insert_after(list, tiny_list_before_begin(list), value, NULL);
+}
+
+int tiny_list_push_back(TinyList *list, int value) {
+    if (!list) return -1;
+    return tiny_list_insert_after(list, list->tail, value, NULL);
+}
+
+int tiny_list_erase_after(TinyList *list, TinyListPos pos) {
+    if (!list || (pos.tiny_ptr < 0 && pos.tiny_ptr != LIST_BEFORE_BEGIN)) return -1;
+    TinyListPos victim = successor(list, pos);
+    if (victim.tiny_ptr < 0) return -1;
+    set_dead(list, victim, 1);
+    list->size--;
+    prune_dead(list, pos);
+    return 0;
+}
+
+int tiny_list_pop_front(TinyList *list, int *value) {
+    if (!list || list->size == 0) return -1;
+    if (value) *value = tiny_list_value(list, tiny_list_begin(list));
+    return tiny_list_erase_after(list, tiny_list_before_begin(list));
+}
+
+TinyListPos tiny_list_before_begin(const TinyList *list) {
+    TinyListPos pos = {0, LIST_BEFORE_BEGIN};
+    (void)list;
+    return pos;
+}
+
+TinyListPos tiny_list_begin(const TinyList *list) {
+    TinyListPos end = {0, -1};
+    return list ? successor(list, tiny_list_before_begin(list)) : end;
+}
+
+TinyListPos tiny_list_next(const TinyList *list, TinyListPos pos) {
+    TinyListPos end = {0, -1};
+    if (!list || pos.tiny_ptr == -1) return end;
+    return successor(list, pos);
+}
+
+int tiny_list_value(const TinyList *list, TinyListPos pos) {
+    if (!list || pos.tiny_ptr < 0) return -1;
+    return list->values[simple_slot_index(list->nodes, pos.key, pos.tiny_ptr)];
+}
+
+size_t tiny_list_size(const TinyList *list) {
+    return list ? list->size : 0;
+}
+
+size_t tiny_list_memory_usage(const TinyList *list) {
+    if (!list) return 0;
+    return sizeof(TinyList) + simple_memory_usage(list->nodes) +
+           list->slots * (sizeof(int) + sizeof(uint16_t)) + (list->slots + 7) / 8;
+}
@@ -0,0 +1,172 @@
+#include "tiny_ptr_map.h"
+#include "tiny_ptr_simple.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+/* Wide buckets keep overflow rare; the key scan covers one in a few vector loads */
+#define MAP_BUCKET_SIZE 32
+
+/* The stash takes the keys whose primary bucket is full, like FixedTable's secondary table */
+#define MAP_STASH_DIVISOR 8
+
+/* Doublings tried before a put gives up */
+#define MAP_GROW_ATTEMPTS 4
+
+/*
+ * A key lives in its primary bucket, or in the stash once that bucket is
+ * full. A spill bit per primary bucket records that some key of it went to
+ * the stash, so lookups of other buckets never probe the stash. Spill bits
+ * are only cleared when the map is rebuilt.
+ */
+struct TinyMap {
+    SimpleTable *primary;
+    SimpleTable *stash;
+    uint64_t *spilled;    /* One bit per primary bucket */
+    size_t capacity;      /* Capacity the tables were created for */
+    double load_factor;
+    size_t size;
+};
+
+static int map_init(TinyMap *map, size_t capacity, double load_factor) {
+    size_t stash_capacity = capacity / MAP_STASH_DIVISOR > 0 ? capacity / MAP_STASH_DIVISOR : 1;
+    map->primary = simple_create_sized(capacity, load_factor, MAP_BUCKET_SIZE);
+    map->stash = simple_create_ex(stash_capacity, load_factor);
+    SimpleGeometry g;
+    if (!map->primary || !map->stash || simple_geometry(map->primary, &g) != 0 ||
+        !(map->spilled = calloc((g.bucket_count + 63) / 64, sizeof(uint64_t)))) {
+        simple_destroy(map->primary);
+        simple_destroy(map->stash);
+        return -1;
+    }
+    map->capacity = capacity;
+    map->load_factor = load_factor;
+    map->size = 0;
+    return 0;
+}
+
+static void map_release(TinyMap *map) {
+    simple_destroy(map->primary);
+    simple_destroy(map->stash);
+    free(map->spilled);
+}
+
+TinyMap* tiny_map_create(size_t capacity, double load_factor) {
+    TinyMap *map = malloc(sizeof(TinyMap));
+    if (!map) return NULL;
+    if (map_init(map, capacity, load_factor) != 0) {
+        free(map);
+        return NULL;
+    }
+    return map;
+}
+
+void tiny_map_destroy(TinyMap *map) {
+    if (!map) return;
+    map_release(map);
+    free(map);
+}
+
+static inline size_t primary_bucket(const TinyMap *map, int key) {
+    return simple_slot_index(map->primary, key, 0) / MAP_BUCKET_SIZE;
+}
+
+static inline int is_spilled(const TinyMap *map, size_t bucket) {
+    return (map->spilled[bucket / 64] >> (bucket % 64)) & 1;
+}
+
+/* Place a key known to be absent; returns 0, or -1 if both its buckets are full */
+static int map_insert(TinyMap *map, int key, int value) {
+    if (simple_allocate_unlocked(map->primary, key, value) >= 0) return 0;
+    if (simple_allocate_unlocked(map->stash, key, value) < 0) return -1;
+    size_t bucket = primary_bucket(map, key);
+    map->spilled[bucket / 64] |= (uint64_t)1 << (bucket % 64);
+    return 0;
+}
+
+typedef struct {
+    TinyMap *map;
+    int failed;
+} MapRebuild;
+
+static void rebuild_entry(void *ctx, int key, int value, int tiny_ptr) {
+    MapRebuild *r = ctx;
+    (void)tiny_ptr;
+    if (!r->failed && map_insert(r->map, key, value) != 0)
+        r->failed = 1;
+}
+
+/* Rebuild into tables twice as large; the old tables survive a failed attempt */
+static int map_grow(TinyMap *map) {
+    size_t capacity = map->capacity;
+    for (int attempt = 0; attempt < MAP_GROW_ATTEMPTS; attempt++) {
+        capacity *= 2;
+        TinyMap bigger;
+        if (map_init(&bigger, capacity, map->load_factor) != 0) return -1;
+        MapRebuild r = {&bigger, 0};
+        simple_visit(map->primary, rebuild_entry, &r);
+        simple_visit(map->stash, rebuild_entry, &r);
+        if (r.failed) {
+            map_release(&bigger);
+            continue;
+        }
+        bigger.size = map->size;
+        map_release(map);
+        *map = bigger;
+        return 0;
+    }
+    return -1;
+}
+
+/* Table holding key and its tiny pointer there, or NULL if key is absent */
+static SimpleTable* map_locate(TinyMap *map, int key, int *tp, int *value) {
+    if ((*tp = simple_lookup_unlocked(map->primary, key, value)) >= 0) return map->primary;
+    if (is_spilled(map, primary_bucket(map, key)) &&
+        (*tp = simple_lookup_unlocked(map->stash, key, value)) >= 0)
+        return map->stash;
+    return NULL;
+}
+
+int tiny_map_put(TinyMap *map, int key, int value) {
+    if (!map) return -1;
+    int tp;
+    SimpleTable *st = map_locate(map, key, &tp, NULL);
+    if (st) {
+        /* The slot just freed is the only change, so the key lands in the same bucket */
+        simple_free_unlocked(st, key, tp);
+        simple_allocate_unlocked(st, key, value);
+        return 0;
+    }
+    while (map_insert(map, key, value) != 0) {
+        if (map_grow(map) != 0) return -1;
+    }
+    map->size++;
+    return 0;
+}
+
+int tiny_map_get(TinyMap *map, int key, int *value) {
+    if (!map) return -1;
+    int tp;
+    return map_locate(map, key, &tp, value) ? 0 : -1;
+}
+
+int tiny_map_erase(TinyMap *map, int key) {
+    if (!map) return -1;
+    int tp;
+    SimpleTable *st = map_locate(map, key, &tp, NULL);
+    if (!st) return -1;
+    simple_free_unlocked(st, key, tp);
+    map->size--;
+    return 0;
+}
+
+size_t tiny_map_size(const TinyMap *map) {
+    return map ? map->size : 0;
+}
+
+size_t tiny_map_memory_usage(const TinyMap *map) {
+    if (!map) return 0;
+    SimpleGeometry g;
+    simple_geometry(map->primary, &g);
+    return sizeof(TinyMap) + simple_memory_usage(map->primary) + simple_memory_usage(map->stash) +
+           (g.bucket_count + 63) / 64 * sizeof(uint64_t);
+}
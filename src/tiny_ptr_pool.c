@@ -0,0 +1,94 @@
+#include "tiny_ptr_pool.h"
+#include "tiny_ptr_simple.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define POOL_ALIGN 16
+
+/* Slabs at least this large come straight from anonymous mmap */
+#define POOL_MMAP_THRESHOLD (1UL << 20)
+
+struct TinyPool {
+    SimpleTable *slots;     /* Mask-only table: claims slots, stores no keys or values */
+    unsigned char *slab;    /* total_slots * stride bytes */
+    size_t slab_bytes;
+    size_t stride;          /* object_size rounded up to POOL_ALIGN */
+    size_t object_size;
+    size_t bucket_size;     /* Tiny pointers lie in [0, bucket_size) */
+};
+
+/* Like the table arrays, a large slab is committed page by page on first use */
+static void* slab_alloc(size_t bytes) {
+    if (bytes >= POOL_MMAP_THRESHOLD) {
+        void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return p == MAP_FAILED ? NULL : p;
+    }
+    void *p = NULL;
+    return posix_memalign(&p, POOL_ALIGN, bytes) == 0 ? p : NULL;
+}
+
+static void slab_release(void *p, size_t bytes) {
+    if (!p) return;
+    if (bytes >= POOL_MMAP_THRESHOLD)
+        munmap(p, bytes);
+    else
+        free(p);
+}
+
+TinyPool* tiny_pool_create(size_t capacity, size_t object_size, double load_factor) {
+    if (object_size == 0) return NULL;
+    TinyPool *pool = malloc(sizeof(TinyPool));
+    if (!pool) return NULL;
+    pool->slots = simple_create_mask_only(capacity, load_factor);
+    SimpleGeometry g;
+    if (!pool->slots || simple_geometry(pool->slots, &g) != 0) {
+        simple_destroy(pool->slots);
+        free(pool);
+        return NULL;
+    }
+    pool->object_size = object_size;
+    pool->bucket_size = g.bucket_size;
+    pool->stride = (object_size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+    pool->slab_bytes = g.bucket_count * g.bucket_size * pool->stride;
+    pool->slab = slab_alloc(pool->slab_bytes);
+    if (!pool->slab) {
+        simple_destroy(pool->slots);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void tiny_pool_destroy(TinyPool *pool) {
+    if (!pool) return;
+    slab_release(pool->slab, pool->slab_bytes);
+    simple_destroy(pool->slots);
+    free(pool);
+}
+
+int tiny_pool_alloc(TinyPool *pool, int key) {
+    if (!pool) return -1;
+    int tp = simple_claim_slot(pool->slots, key);
+    if (tp != -1)
+        memset(pool->slab + simple_slot_index(pool->slots, key, tp) * pool->stride, 0, pool->object_size);
+    return tp;
+}
+
+void* tiny_pool_deref(TinyPool *pool, int key, int tiny_ptr) {
+    if (!pool || tiny_ptr < 0 || (size_t)tiny_ptr >= pool->bucket_size) return NULL;
+    return pool->slab + simple_slot_index(pool->slots, key, tiny_ptr) * pool->stride;
+}
+
+void tiny_pool_free(TinyPool *pool, int key, int tiny_ptr) {
+    if (!pool || tiny_ptr < 0 || (size_t)tiny_ptr >= pool->bucket_size) return;
+    simple_release_slot(pool->slots, key, tiny_ptr);
+}
+
+size_t tiny_pool_live_count(const TinyPool *pool) {
+    return pool ? simple_live_count(pool->slots) : 0;
+}
+
+size_t tiny_pool_stride(const TinyPool *pool) {
+    return pool ? pool->stride : 0;
+}
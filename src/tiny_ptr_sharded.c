@@ -0,0 +1,392 @@
+#include "tiny_ptr_sharded.h"
+#include "tiny_ptr_simple.h"
+#include "tiny_ptr_epoch.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define SHARD_CACHE_LINE 64
+#define SHARD_HASH_SEED 0x7f4a7c15
+
+/*
+ * Each shard is a SimpleTable with its own epoch domain and resize lock,
+ * padded to whole cache lines so that traffic on one shard never shares a
+ * line with its neighbours. Dereference and find only pin the shard's
+ * table in its epoch and read it with atomic loads; the table mutex is
+ * left to allocate, free and resize.
+ */
+typedef struct {
+    SimpleTable *table;            /* Swapped atomically when the shard resizes */
+    EpochDomain *epoch;            /* Dereferences pin the shard's current table */
+    pthread_rwlock_t resize_lock;  /* Shared by allocate/free, exclusive while resizing */
+    int cursors;                   /* Cursors inside the shard; resize and compact skip it meanwhile */
+} __attribute__((aligned(SHARD_CACHE_LINE))) Shard;
+
+struct ShardedTable {
+    size_t shard_count;   /* Number of shards (power of 2) */
+    int shard_bits;       /* log2(shard_count) */
+    double load_factor;
+    Shard *shards;
+};
+
+/* Hash used only for shard selection; independent of the per-table bucket hash */
+static inline uint32_t shard_hash(int key) {
+    uint32_t h = (uint32_t) key ^ SHARD_HASH_SEED;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+static inline Shard* shard_for(ShardedTable *sh, int key) {
+    return &sh->shards[sharded_shard_of(sh, key)];
+}
+
+static inline SimpleTable* shard_table(Shard *s) {
+    return __atomic_load_n(&s->table, __ATOMIC_SEQ_CST);
+}
+
+static void shard_destroy(Shard *s) {
+    simple_destroy(s->table);
+    epoch_destroy(s->epoch);
+    pthread_rwlock_destroy(&s->resize_lock);
+}
+
+size_t sharded_default_shard_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (size_t)cpus : 1;
+}
+
+ShardedTable* sharded_create(size_t total_capacity, size_t shard_count, double load_factor) {
+    if (total_capacity == 0) return NULL;
+    if (shard_count == 0)
+        shard_count = sharded_default_shard_count();
+    ShardedTable *sh = malloc(sizeof(ShardedTable));
+    if (!sh) return NULL;
+    sh->shard_count = 1;
+    sh->shard_bits = 0;
+    while (sh->shard_count < shard_count) {
+        sh->shard_count *= 2;
+        sh->shard_bits++;
+    }
+    sh->load_factor = load_factor;
+    if (posix_memalign((void **)&sh->shards, SHARD_CACHE_LINE, sh->shard_count * sizeof(Shard)) != 0) {
+        free(sh);
+        return NULL;
+    }
+    size_t shard_capacity = (total_capacity + sh->shard_count - 1) / sh->shard_count;
+    for (size_t i = 0; i < sh->shard_count; i++) {
+        Shard *s = &sh->shards[i];
+        s->table = simple_create_ex(shard_capacity, load_factor);
+        s->epoch = epoch_create();
+        if (!s->table || !s->epoch) {
+            simple_destroy(s->table);
+            epoch_destroy(s->epoch);
+            for (size_t j = 0; j < i; j++)
+                shard_destroy(&sh->shards[j]);
+            free(sh->shards);
+            free(sh);
+            return NULL;
+        }
+        pthread_rwlock_init(&s->resize_lock, NULL);
+        s->cursors = 0;
+    }
+    return sh;
+}
+
+void sharded_destroy(ShardedTable *sh) {
+    if (!sh) return;
+    for (size_t i = 0; i < sh->shard_count; i++)
+        shard_destroy(&sh->shards[i]);
+    free(sh->shards);
+    free(sh);
+}
+
+size_t sharded_shard_count(const ShardedTable *sh) {
+    return sh ? sh->shard_count : 0;
+}
+
+size_t sharded_shard_of(const ShardedTable *sh, int key) {
+    if (sh->shard_bits == 0) return 0;
+    return shard_hash(key) >> (32 - sh->shard_bits);
+}
+
+int sharded_allocate(ShardedTable *sh, int key, int value) {
+    if (!sh) return -1;
+    Shard *s = shard_for(sh, key);
+    pthread_rwlock_rdlock(&s->resize_lock);
+    int ret = simple_allocate(s->table, key, value);
+    pthread_rwlock_unlock(&s->resize_lock);
+    return ret;
+}
+
+int sharded_dereference(ShardedTable *sh, int key, int tiny_ptr) {
+    if (!sh) return -1;
+    Shard *s = shard_for(sh, key);
+    int ticket = epoch_enter(s->epoch);
+    int ret = simple_dereference_unlocked(shard_table(s), key, tiny_ptr);
+    epoch_exit(s->epoch, ticket);
+    return ret;
+}
+
+void sharded_free(ShardedTable *sh, int key, int tiny_ptr) {
+    if (!sh) return;
+    Shard *s = shard_for(sh, key);
+    pthread_rwlock_rdlock(&s->resize_lock);
+    simple_free(s->table, key, tiny_ptr);
+    pthread_rwlock_unlock(&s->resize_lock);
+}
+
+size_t sharded_find(ShardedTable *sh, int key, int *out_tiny_ptrs, size_t max) {
+    if (!sh || (max > 0 && !out_tiny_ptrs)) return 0;
+    Shard *s = shard_for(sh, key);
+    int ticket = epoch_enter(s->epoch);
+    size_t found = simple_find_unlocked(shard_table(s), key, out_tiny_ptrs, max);
+    epoch_exit(s->epoch, ticket);
+    return found;
+}
+
+int sharded_resize_shard(ShardedTable *sh, size_t shard, size_t new_capacity, int nthreads) {
+    if (!sh || shard >= sh->shard_count) return -1;
+    Shard *s = &sh->shards[shard];
+    pthread_rwlock_wrlock(&s->resize_lock);
+    if (__atomic_load_n(&s->cursors, __ATOMIC_ACQUIRE) > 0) {
+        pthread_rwlock_unlock(&s->resize_lock);
+        return -1;
+    }
+    SimpleTable *old_st = s->table;
+    SimpleTable *new_st = simple_rehash_parallel(old_st, new_capacity, nthreads);
+    if (!new_st) {
+        pthread_rwlock_unlock(&s->resize_lock);
+        return -1;
+    }
+    __atomic_store_n(&s->table, new_st, __ATOMIC_SEQ_CST);
+    pthread_rwlock_unlock(&s->resize_lock);
+    epoch_synchronize(s->epoch);
+    simple_destroy(old_st);
+    return 0;
+}
+
+int sharded_resize(ShardedTable *sh, size_t new_total_capacity, int nthreads) {
+    if (!sh || new_total_capacity == 0) return -1;
+    size_t shard_capacity = (new_total_capacity + sh->shard_count - 1) / sh->shard_count;
+    for (size_t i = 0; i < sh->shard_count; i++) {
+        if (sharded_resize_shard(sh, i, shard_capacity, nthreads) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+void sharded_cursor_init(ShardedTable *sh, ShardedCursor *cur, size_t part, size_t parts) {
+    if (!cur) return;
+    size_t shards = sh ? sh->shard_count : 0;
+    cur->parts = parts > 0 ? parts : 1;
+    cur->begin_unit = cur->end_unit = shards * cur->parts;
+    if (parts > 0 && part < parts) {
+        cur->begin_unit = shards * part;
+        cur->end_unit = shards * (part + 1);
+    }
+    cur->shard = cur->begin_unit / cur->parts;
+    cur->table = NULL;
+    simple_cursor_init(NULL, &cur->inner, 0, 0);
+}
+
+/*
+ * Count the cursor into its shard and aim the inner cursor at the slice of
+ * the shard's buckets inside the range. The count is taken under the
+ * resize lock, so the shard's table stays put until the cursor leaves.
+ */
+static void sharded_cursor_enter(ShardedTable *sh, ShardedCursor *cur) {
+    Shard *s = &sh->shards[cur->shard];
+    pthread_rwlock_rdlock(&s->resize_lock);
+    __atomic_add_fetch(&s->cursors, 1, __ATOMIC_RELAXED);
+    cur->table = s->table;
+    pthread_rwlock_unlock(&s->resize_lock);
+    size_t first = cur->shard * cur->parts;
+    size_t lo = (cur->begin_unit > first ? cur->begin_unit : first) - first;
+    size_t hi = (cur->end_unit < first + cur->parts ? cur->end_unit : first + cur->parts) - first;
+    SimpleGeometry g;
+    simple_geometry(cur->table, &g);
+    size_t n = g.bucket_count;
+    simple_cursor_init(cur->table, &cur->inner, n / cur->parts * lo + n % cur->parts * lo / cur->parts,
+                       n / cur->parts * hi + n % cur->parts * hi / cur->parts);
+}
+
+int sharded_cursor_next(ShardedTable *sh, ShardedCursor *cur, int *key, int *value, int *tiny_ptr) {
+    if (!sh || !cur) return 0;
+    while (cur->shard * cur->parts < cur->end_unit) {
+        if (!cur->table)
+            sharded_cursor_enter(sh, cur);
+        if (simple_cursor_next(cur->table, &cur->inner, key, value, tiny_ptr))
+            return 1;
+        sharded_cursor_close(sh, cur);
+        cur->shard++;
+    }
+    return 0;
+}
+
+void sharded_cursor_close(ShardedTable *sh, ShardedCursor *cur) {
+    if (!sh || !cur || !cur->table) return;
+    cur->table = NULL;
+    __atomic_sub_fetch(&sh->shards[cur->shard].cursors, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * sharded_bulk_load groups the pairs by shard and bulk-loads each shard in
+ * turn, with nthreads workers inside each shard.
+ */
+size_t sharded_bulk_load(ShardedTable *sh, const int *keys, const int *values, size_t n,
+                         int *out_tiny_ptrs, int nthreads) {
+    if (!sh || n == 0 || !keys || !values || !out_tiny_ptrs) return 0;
+    size_t *group_start = calloc(sh->shard_count + 1, sizeof(size_t));
+    size_t *cursor = malloc(sh->shard_count * sizeof(size_t));
+    size_t *order = malloc(n * sizeof(size_t));
+    int *skeys = malloc(n * sizeof(int));
+    int *svalues = malloc(n * sizeof(int));
+    int *stps = malloc(n * sizeof(int));
+    if (!group_start || !cursor || !order || !skeys || !svalues || !stps) {
+        free(group_start); free(cursor); free(order); free(skeys); free(svalues); free(stps);
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++)
+        group_start[sharded_shard_of(sh, keys[i]) + 1]++;
+    for (size_t s = 0; s < sh->shard_count; s++) {
+        group_start[s + 1] += group_start[s];
+        cursor[s] = group_start[s];
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t k = cursor[sharded_shard_of(sh, keys[i])]++;
+        order[k] = i;
+        skeys[k] = keys[i];
+        svalues[k] = values[i];
+    }
+    size_t placed = 0;
+    for (size_t s = 0; s < sh->shard_count; s++) {
+        size_t begin = group_start[s], m = group_start[s + 1] - begin;
+        if (m == 0) continue;
+        Shard *shard = &sh->shards[s];
+        pthread_rwlock_rdlock(&shard->resize_lock);
+        placed += simple_bulk_load(shard->table, skeys + begin, svalues + begin, m, stps + begin, nthreads);
+        pthread_rwlock_unlock(&shard->resize_lock);
+    }
+    for (size_t k = 0; k < n; k++)
+        out_tiny_ptrs[order[k]] = stps[k];
+    free(group_start); free(cursor); free(order); free(skeys); free(svalues); free(stps);
+    return placed;
+}
+
+/*
+ * sharded_compact compacts the shards one at a time; a shard whose live
+ * entries cannot fit a smaller table keeps its current one. A shard with a
+ * cursor inside is skipped, and the call then returns -1.
+ */
+int sharded_compact(ShardedTable *sh, tiny_ptr_remap_fn remap, void *ctx) {
+    if (!sh) return -1;
+    int ret = 0;
+    for (size_t i = 0; i < sh->shard_count; i++) {
+        Shard *s = &sh->shards[i];
+        pthread_rwlock_wrlock(&s->resize_lock);
+        if (__atomic_load_n(&s->cursors, __ATOMIC_ACQUIRE) > 0) {
+            pthread_rwlock_unlock(&s->resize_lock);
+            ret = -1;
+            continue;
+        }
+        SimpleTable *old_st = s->table;
+        SimpleTable *new_st = simple_compact(old_st, remap, ctx);
+        if (!new_st) {
+            pthread_rwlock_unlock(&s->resize_lock);
+            continue;
+        }
+        __atomic_store_n(&s->table, new_st, __ATOMIC_SEQ_CST);
+        pthread_rwlock_unlock(&s->resize_lock);
+        epoch_synchronize(s->epoch);
+        simple_destroy(old_st);
+    }
+    return ret;
+}
+
+size_t sharded_memory_usage(ShardedTable *sh) {
+    if (!sh) return 0;
+    size_t bytes = sizeof(ShardedTable) + sh->shard_count * sizeof(Shard);
+    for (size_t i = 0; i < sh->shard_count; i++) {
+        Shard *s = &sh->shards[i];
+        int ticket = epoch_enter(s->epoch);
+        bytes += simple_memory_usage(shard_table(s));
+        epoch_exit(s->epoch, ticket);
+    }
+    return bytes;
+}
+
+/* Frozen ShardedTable: this header, one offset per shard, then the shard images */
+typedef struct {
+    uint64_t shard_bits;
+} FrozenShardedHeader;
+
+void* sharded_freeze(ShardedTable *sh, size_t *out_size) {
+    if (!sh || !out_size) return NULL;
+    void **images = calloc(sh->shard_count, sizeof(void *));
+    size_t *sizes = calloc(sh->shard_count, sizeof(size_t));
+    if (!images || !sizes) {
+        free(images); free(sizes);
+        return NULL;
+    }
+    size_t size = sizeof(FrozenShardedHeader) + sh->shard_count * sizeof(uint64_t);
+    int ok = 1;
+    for (size_t i = 0; i < sh->shard_count && ok; i++) {
+        Shard *s = &sh->shards[i];
+        pthread_rwlock_wrlock(&s->resize_lock);
+        images[i] = simple_freeze(s->table, &sizes[i]);
+        pthread_rwlock_unlock(&s->resize_lock);
+        if (!images[i]) ok = 0;
+        size += sizes[i];
+    }
+    unsigned char *image = ok ? malloc(size) : NULL;
+    if (image) {
+        FrozenShardedHeader *h = (FrozenShardedHeader *)image;
+        h->shard_bits = (uint64_t)sh->shard_bits;
+        uint64_t *offsets = (uint64_t *)(h + 1);
+        uint64_t offset = sizeof(FrozenShardedHeader) + sh->shard_count * sizeof(uint64_t);
+        for (size_t i = 0; i < sh->shard_count; i++) {
+            offsets[i] = offset;
+            memcpy(image + offset, images[i], sizes[i]);
+            offset += sizes[i];
+        }
+        *out_size = size;
+    }
+    for (size_t i = 0; i < sh->shard_count; i++)
+        free(images[i]);
+    free(images);
+    free(sizes);
+    return image;
+}
+
+int sharded_frozen_check(const void *image, size_t size) {
+    if (!image || size < sizeof(FrozenShardedHeader)) return -1;
+    const FrozenShardedHeader *h = image;
+    if (h->shard_bits >= 32) return -1;
+    size_t count = (size_t)1 << h->shard_bits;
+    if (count > (size - sizeof(FrozenShardedHeader)) / sizeof(uint64_t)) return -1;
+    size_t offset = sizeof(FrozenShardedHeader) + count * sizeof(uint64_t);
+    const uint64_t *offsets = (const uint64_t *)(h + 1);
+    /* The shard images follow the offsets back to back and fill the rest */
+    for (size_t i = 0; i < count; i++) {
+        if (offsets[i] != offset) return -1;
+        size_t shard_size = simple_frozen_check((const unsigned char *)image + offset, size - offset);
+        if (shard_size == 0) return -1;
+        offset += shard_size;
+    }
+    return offset == size ? 0 : -1;
+}
+
+int sharded_frozen_dereference(const void *image, int key, int tiny_ptr) {
+    if (!image) return -1;
+    const FrozenShardedHeader *h = image;
+    size_t shard = h->shard_bits == 0 ? 0 : shard_hash(key) >> (32 - h->shard_bits);
+    const uint64_t *offsets = (const uint64_t *)(h + 1);
+    return simple_frozen_dereference((const unsigned char *)image + offsets[shard], key, tiny_ptr);
+}
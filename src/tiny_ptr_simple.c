@@ -1,202 +1,1437 @@
-#include "tiny_ptr_simple.h"
-#include <stdlib.h>
-#include <stdio.h>
-#include <pthread.h>
-#include <stdint.h>
-#include <math.h>
-
-#define TINY_PTR_MAX_BUCKET_SIZE 32
-
-/* 
- * Hash function with seed (mixing similar to MurmurHash3 finalizer).
- */
-static inline uint32_t hash_int_with_seed(int key, uint32_t seed) {
-    uint32_t h = (uint32_t) key;
-    h ^= seed;
-    h ^= h >> 16;
-    h *= 0x85ebca6b;
-    h ^= h >> 13;
-    h *= 0xc2b2ae35;
-    h ^= h >> 16;
-    return h;
-}
-
-// Returns the index of the least–significant set bit.
-static inline int find_first_free(uint32_t free_mask) {
-    return free_mask ? __builtin_ctz(free_mask) : -1;
-}
-
-// Computes the next power of two greater than or equal to x.
-static size_t next_power_of_two(size_t x) {
-    size_t power = 1;
-    while (power < x)
-        power *= 2;
-    return power;
-}
-
-// Computes floor(log2(x)) for x > 0.
-static int int_log2(int x) {
-    int log = 0;
-    while (x >>= 1)
-        log++;
-    return log;
-}
-
-/* The SimpleTable structure now stores a target load factor.
-   The table is allocated so that total_slots >= ceil(capacity/load_factor). */
-struct SimpleTable {
-    size_t requested_capacity;  /* The maximum number of items intended */
-    size_t total_slots;         /* Total slots available (bucket_count * bucket_size) */
-    size_t bucket_count;        /* Number of buckets (power of 2) */
-    size_t bucket_size;         /* Number of slots per bucket */
-    int *store;                 /* Array storing the values */
-    int *keys;                  /* Array storing the keys (-1 indicates free) */
-    uint32_t *bucket_free;      /* Bitmask per bucket: bit set means free */
-    uint32_t hash_seed;         /* Seed used in the hash function */
-    double load_factor;         /* Target load factor (e.g., 0.9) */
-    pthread_mutex_t mutex;      /* Mutex for thread safety */
-};
-
-SimpleTable* simple_create_ex(size_t capacity, double load_factor) {
-    if (capacity == 0 || load_factor <= 0 || load_factor > 1.0) return NULL;
-    SimpleTable *st = malloc(sizeof(SimpleTable));
-    if (!st) return NULL;
-    st->requested_capacity = capacity;
-    st->load_factor = load_factor;
-    /* Choose bucket size based on capacity; enforce a minimum of 8 slots per bucket */
-    int bs = int_log2(capacity);
-    bs = bs / 2;
-    if (bs < 8) bs = 8;
-    if (bs > TINY_PTR_MAX_BUCKET_SIZE)
-        bs = TINY_PTR_MAX_BUCKET_SIZE;
-    st->bucket_size = (size_t)bs;
-    /* Compute minimum slots so that capacity/slots <= load_factor */
-    size_t min_slots = (size_t) ceil((double) capacity / load_factor);
-    size_t desired_buckets = (min_slots + st->bucket_size - 1) / st->bucket_size;
-    st->bucket_count = next_power_of_two(desired_buckets);
-    st->total_slots = st->bucket_count * st->bucket_size;
-    st->store = calloc(st->total_slots, sizeof(int));
-    st->keys = malloc(st->total_slots * sizeof(int));
-    st->bucket_free = malloc(st->bucket_count * sizeof(uint32_t));
-    if (!st->store || !st->keys || !st->bucket_free) {
-        free(st->store); free(st->keys); free(st->bucket_free);
-        free(st);
-        return NULL;
-    }
-    for (size_t i = 0; i < st->total_slots; i++) {
-        st->keys[i] = -1;  // Mark slot as free.
-    }
-    for (size_t i = 0; i < st->bucket_count; i++) {
-        st->bucket_free[i] = ((1U << st->bucket_size) - 1);
-    }
-    pthread_mutex_init(&st->mutex, NULL);
-    /* Set the hash seed to depend on the requested capacity */
-    st->hash_seed = ((uint32_t) capacity) ^ 0x9e3779b9;
-    return st;
-}
-
-void simple_destroy(SimpleTable *st) {
-    if (!st) return;
-    pthread_mutex_destroy(&st->mutex);
-    free(st->store);
-    free(st->keys);
-    free(st->bucket_free);
-    free(st);
-}
-
-int simple_allocate(SimpleTable *st, int key, int value) {
-    if (!st) return -1;
-    pthread_mutex_lock(&st->mutex);
-    uint32_t h = hash_int_with_seed(key, st->hash_seed);
-    int bucket = h & (st->bucket_count - 1);
-    uint32_t free_mask = st->bucket_free[bucket];
-    if (free_mask == 0) {
-        pthread_mutex_unlock(&st->mutex);
-        return -1;
-    }
-    int slot_offset = find_first_free(free_mask);
-    if (slot_offset < 0) {
-        pthread_mutex_unlock(&st->mutex);
-        return -1;
-    }
-    st->bucket_free[bucket] &= ~(1U << slot_offset);
-    size_t index = bucket * st->bucket_size + slot_offset;
-    st->store[index] = value;
-    st->keys[index] = key;
-    pthread_mutex_unlock(&st->mutex);
-    return slot_offset;
-}
-
-int simple_dereference(SimpleTable *st, int key, int tiny_ptr) {
-    if (!st) return -1;
-    pthread_mutex_lock(&st->mutex);
-    uint32_t h = hash_int_with_seed(key, st->hash_seed);
-    int bucket = h & (st->bucket_count - 1);
-    size_t index = bucket * st->bucket_size + tiny_ptr;
-    int ret = st->store[index];
-    pthread_mutex_unlock(&st->mutex);
-    return ret;
-}
-
-void simple_free(SimpleTable *st, int key, int tiny_ptr) {
-    if (!st) return;
-    pthread_mutex_lock(&st->mutex);
-    uint32_t h = hash_int_with_seed(key, st->hash_seed);
-    int bucket = h & (st->bucket_count - 1);
-    size_t index = bucket * st->bucket_size + tiny_ptr;
-    st->keys[index] = -1;
-    st->store[index] = 0;  // Optionally clear the value.
-    st->bucket_free[bucket] |= (1U << tiny_ptr);
-    pthread_mutex_unlock(&st->mutex);
-}
-
-/*
- * simple_resize creates a new SimpleTable with new_capacity and the same load factor,
- * rehashes all allocated entries from the old table into the new table,
- * and destroys the old table.
- */
-SimpleTable* simple_resize(SimpleTable *old_st, size_t new_capacity) {
-    if (!old_st) return NULL;
-    SimpleTable *new_st = simple_create_ex(new_capacity, old_st->load_factor);
-    if (!new_st) return NULL;
-
-    pthread_mutex_lock(&old_st->mutex);
-    pthread_mutex_lock(&new_st->mutex);
-    for (size_t i = 0; i < old_st->total_slots; i++) {
-        if (old_st->keys[i] != -1) {
-            int key = old_st->keys[i];
-            int value = old_st->store[i];
-            uint32_t h = hash_int_with_seed(key, new_st->hash_seed);
-            int bucket = h & (new_st->bucket_count - 1);
-            uint32_t free_mask = new_st->bucket_free[bucket];
-            if (free_mask == 0) {
-                pthread_mutex_unlock(&new_st->mutex);
-                pthread_mutex_unlock(&old_st->mutex);
-                simple_destroy(new_st);
-                return NULL;
-            }
-            int slot_offset = find_first_free(free_mask);
-            if (slot_offset < 0) {
-                pthread_mutex_unlock(&new_st->mutex);
-                pthread_mutex_unlock(&old_st->mutex);
-                simple_destroy(new_st);
-                return NULL;
-            }
-            new_st->bucket_free[bucket] &= ~(1U << slot_offset);
-            size_t new_index = bucket * new_st->bucket_size + slot_offset;
-            new_st->store[new_index] = value;
-            new_st->keys[new_index] = key;
-        }
-    }
-    pthread_mutex_unlock(&new_st->mutex);
-    pthread_mutex_unlock(&old_st->mutex);
-    simple_destroy(old_st);
-    return new_st;
-}
-
-/* 
- * Alias for legacy code: simple_create calls simple_create_ex with default load factor 0.9.
- */
-SimpleTable* simple_create(size_t capacity) {
-    return simple_create_ex(capacity, 0.9);
-}
+#define _GNU_SOURCE  /* memfd_create */
+#include "tiny_ptr_simple.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define TINY_PTR_MAX_BUCKET_SIZE 64
+
+/*
+ * Runtime CPU dispatch. Hot kernels are compiled once per x86-64 feature
+ * level (v2: SSE4.2/POPCNT, v3: AVX2/BMI2, v4: AVX-512) and the dynamic
+ * loader binds the best clone through an ifunc before main runs, so one
+ * binary serves a mixed fleet. Build with -DTINY_PTR_NO_DISPATCH to get
+ * the generic code only.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(TINY_PTR_NO_DISPATCH)
+#define TINY_PTR_DISPATCH 1
+#define TINY_PTR_CLONES \
+    __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#else
+#define TINY_PTR_DISPATCH 0
+#define TINY_PTR_CLONES
+#endif
+
+/* Arrays at least this large come straight from anonymous mmap */
+#define TINY_PTR_MMAP_THRESHOLD (1UL << 20)
+
+/* 
+ * Hash function with seed (mixing similar to MurmurHash3 finalizer).
+ */
+static inline uint32_t hash_int_with_seed(int key, uint32_t seed) {
+    uint32_t h = (uint32_t) key;
+    h ^= seed;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+// Returns the index of the least–significant set bit.
+static inline int find_first_free(uint64_t free_mask) {
+    return free_mask ? __builtin_ctzll(free_mask) : -1;
+}
+
+// Returns the mask bit of a slot within its bucket.
+static inline uint64_t slot_bit(int slot_offset) {
+    return (uint64_t)1 << slot_offset;
+}
+
+/*
+ * Table arrays are allocated zeroed, and zero means empty everywhere, so a
+ * new table is never written at creation. Large arrays are anonymous
+ * mappings whose pages stay shared zero pages until first written.
+ */
+static void* table_alloc(size_t bytes) {
+    if (bytes >= TINY_PTR_MMAP_THRESHOLD) {
+        void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return p == MAP_FAILED ? NULL : p;
+    }
+    return calloc(1, bytes);
+}
+
+static void table_release(void *p, size_t bytes) {
+    if (!p) return;
+    if (bytes >= TINY_PTR_MMAP_THRESHOLD)
+        munmap(p, bytes);
+    else
+        free(p);
+}
+
+// Computes the next power of two greater than or equal to x.
+static size_t next_power_of_two(size_t x) {
+    size_t power = 1;
+    while (power < x)
+        power *= 2;
+    return power;
+}
+
+// Computes floor(log2(x)) for x > 0.
+static int int_log2(int x) {
+    int log = 0;
+    while (x >>= 1)
+        log++;
+    return log;
+}
+
+/* The SimpleTable structure now stores a target load factor.
+   The table is allocated so that total_slots >= ceil(capacity/load_factor). */
+struct SimpleTable {
+    size_t requested_capacity;  /* The maximum number of items intended */
+    size_t total_slots;         /* Total slots available (bucket_count * bucket_size) */
+    size_t bucket_count;        /* Number of buckets (power of 2) */
+    size_t bucket_size;         /* Number of slots per bucket */
+    size_t requested_bucket_size; /* Explicit bucket size, or 0 to derive it from capacity */
+    int *store;                 /* Array storing the values */
+    int *keys;                  /* Array storing the keys (meaningful only for occupied slots) */
+    uint64_t *bucket_used;      /* Bitmask per bucket: bit set means occupied */
+    uint64_t *bucket_claimed;   /* Lock-free tables only: slots taken by the atomic writers, published or not */
+    uint32_t hash_seed;         /* Seed used in the hash function */
+    double load_factor;         /* Target load factor (e.g., 0.9) */
+    pthread_mutex_t mutex;      /* Mutex for thread safety */
+    pthread_mutex_t *lock;      /* &mutex, or the process-shared mutex of a shared table */
+    void *shm_base;             /* Mapping of a shared table's region, or NULL */
+    size_t shm_size;            /* Size of that mapping */
+    int shm_fd;                 /* Descriptor of the shared region, or -1 */
+};
+
+/*
+ * The lock of a shared table is robust: if another process died holding it,
+ * the next locker takes it over. Every update of a slot sets or clears its
+ * mask bit last, so the table stays usable.
+ */
+static inline void table_lock(SimpleTable *st) {
+    if (pthread_mutex_lock(st->lock) == EOWNERDEAD)
+        pthread_mutex_consistent(st->lock);
+}
+
+static inline void table_unlock(SimpleTable *st) {
+    pthread_mutex_unlock(st->lock);
+}
+
+/* Mask with one bit per slot of a bucket */
+static inline uint64_t full_bucket_mask(const SimpleTable *st) {
+    return st->bucket_size >= 64 ? ~(uint64_t)0 : slot_bit((int)st->bucket_size) - 1;
+}
+
+/* Free slots of a bucket given its occupancy mask */
+static inline uint64_t free_slots(const SimpleTable *st, uint64_t used_mask) {
+    return ~used_mask & full_bucket_mask(st);
+}
+
+/*
+ * Mask-array scanning: returns the first bucket in [from, end) holding at
+ * least one entry (a non-zero occupancy mask), or end. Walks over sparse
+ * tables spend most of their time here, so the scan tests 4 or 8 masks at
+ * once when the CPU supports AVX2 or AVX-512.
+ */
+typedef size_t (*occupied_scan_fn)(const uint64_t *masks, size_t from, size_t end);
+
+static size_t next_occupied_scalar(const uint64_t *masks, size_t from, size_t end) {
+    for (size_t b = from; b < end; b++) {
+        if (masks[b] != 0) return b;
+    }
+    return end;
+}
+
+#if TINY_PTR_DISPATCH
+__attribute__((target("avx2")))
+static size_t next_occupied_avx2(const uint64_t *masks, size_t from, size_t end) {
+    __m256i zero = _mm256_setzero_si256();
+    size_t b = from;
+    for (; b + 4 <= end; b += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(masks + b));
+        int empty = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, zero)));
+        if (empty != 0xF) return b + __builtin_ctz(~empty & 0xF);
+    }
+    return next_occupied_scalar(masks, b, end);
+}
+
+__attribute__((target("avx512f")))
+static size_t next_occupied_avx512(const uint64_t *masks, size_t from, size_t end) {
+    size_t b = from;
+    for (; b + 8 <= end; b += 8) {
+        __m512i v = _mm512_loadu_si512(masks + b);
+        __mmask8 occupied = _mm512_test_epi64_mask(v, v);
+        if (occupied) return b + __builtin_ctz(occupied);
+    }
+    return next_occupied_scalar(masks, b, end);
+}
+#endif
+
+/* Same feature-level ladder the target_clones resolvers walk */
+static TinyPtrSimdLevel detect_simd_level(void) {
+#if TINY_PTR_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("x86-64-v4")) return TINY_PTR_SIMD_AVX512;
+    if (__builtin_cpu_supports("x86-64-v3")) return TINY_PTR_SIMD_AVX2;
+    if (__builtin_cpu_supports("x86-64-v2")) return TINY_PTR_SIMD_SSE42;
+#endif
+    return TINY_PTR_SIMD_GENERIC;
+}
+
+#if TINY_PTR_DISPATCH
+// ifunc resolver: binds next_occupied_bucket once, at load time.
+static occupied_scan_fn resolve_next_occupied(void) {
+    switch (detect_simd_level()) {
+        case TINY_PTR_SIMD_AVX512: return next_occupied_avx512;
+        case TINY_PTR_SIMD_AVX2: return next_occupied_avx2;
+        default: return next_occupied_scalar;
+    }
+}
+
+static size_t next_occupied_bucket(const uint64_t *masks, size_t from, size_t end)
+    __attribute__((ifunc("resolve_next_occupied")));
+#else
+static size_t next_occupied_bucket(const uint64_t *masks, size_t from, size_t end) {
+    return next_occupied_scalar(masks, from, end);
+}
+#endif
+
+TinyPtrSimdLevel simple_simd_level(void) {
+    return detect_simd_level();
+}
+
+const char* simple_simd_level_name(TinyPtrSimdLevel level) {
+    switch (level) {
+        case TINY_PTR_SIMD_SSE42: return "sse4.2";
+        case TINY_PTR_SIMD_AVX2: return "avx2";
+        case TINY_PTR_SIMD_AVX512: return "avx512";
+        default: return "generic";
+    }
+}
+
+/*
+ * Bucket key scan for lookups by key: returns a mask with bit i set when
+ * keys[i] == key, for i < bucket_size. The SIMD versions compare 4, 8 or
+ * 16 keys per instruction and finish a partial vector with scalar code, so
+ * they never read past the bucket.
+ */
+typedef uint64_t (*key_scan_fn)(const int *keys, size_t bucket_size, int key);
+
+static uint64_t key_scan_scalar(const int *keys, size_t bucket_size, int key) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < bucket_size; i++)
+        mask |= (uint64_t)(keys[i] == key) << i;
+    return mask;
+}
+
+#if TINY_PTR_DISPATCH
+__attribute__((target("sse4.2")))
+static uint64_t key_scan_sse(const int *keys, size_t bucket_size, int key) {
+    __m128i needle = _mm_set1_epi32(key);
+    uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 4 <= bucket_size; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(keys + i));
+        mask |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, needle))) << i;
+    }
+    if (i < bucket_size)
+        mask |= key_scan_scalar(keys + i, bucket_size - i, key) << i;
+    return mask;
+}
+
+__attribute__((target("avx2")))
+static uint64_t key_scan_avx2(const int *keys, size_t bucket_size, int key) {
+    __m256i needle = _mm256_set1_epi32(key);
+    uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 8 <= bucket_size; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(keys + i));
+        mask |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, needle))) << i;
+    }
+    if (i < bucket_size)
+        mask |= key_scan_scalar(keys + i, bucket_size - i, key) << i;
+    return mask;
+}
+
+__attribute__((target("avx512f")))
+static uint64_t key_scan_avx512(const int *keys, size_t bucket_size, int key) {
+    __m512i needle = _mm512_set1_epi32(key);
+    uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 16 <= bucket_size; i += 16) {
+        __m512i v = _mm512_loadu_si512(keys + i);
+        mask |= (uint64_t)_mm512_cmpeq_epi32_mask(v, needle) << i;
+    }
+    if (i < bucket_size)
+        mask |= key_scan_scalar(keys + i, bucket_size - i, key) << i;
+    return mask;
+}
+
+static key_scan_fn resolve_key_scan(void) {
+    switch (detect_simd_level()) {
+        case TINY_PTR_SIMD_AVX512: return key_scan_avx512;
+        case TINY_PTR_SIMD_AVX2: return key_scan_avx2;
+        case TINY_PTR_SIMD_SSE42: return key_scan_sse;
+        default: return key_scan_scalar;
+    }
+}
+
+static uint64_t key_scan(const int *keys, size_t bucket_size, int key)
+    __attribute__((ifunc("resolve_key_scan")));
+#else
+static uint64_t key_scan(const int *keys, size_t bucket_size, int key) {
+    return key_scan_scalar(keys, bucket_size, key);
+}
+#endif
+
+/* Batch hashing kernel: bucket index of each of n keys */
+TINY_PTR_CLONES
+static void hash_to_buckets(const int *keys, size_t n, uint32_t seed, uint32_t bucket_mask, uint32_t *out) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = hash_int_with_seed(keys[i], seed) & bucket_mask;
+}
+
+/* Batch dereference kernel: hashes and gathers n values */
+TINY_PTR_CLONES
+static void dereference_kernel(const int *store, size_t bucket_size, uint32_t seed, uint32_t bucket_mask,
+                               const int *keys, const int *tiny_ptrs, size_t n, int *out) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t bucket = hash_int_with_seed(keys[i], seed) & bucket_mask;
+        out[i] = store[bucket * bucket_size + tiny_ptrs[i]];
+    }
+}
+
+SimpleTable* simple_create_ex(size_t capacity, double load_factor) {
+    return simple_create_sized(capacity, load_factor, 0);
+}
+
+/* Fills in the sizing fields of st; returns -1 for invalid parameters. */
+static int table_geometry(SimpleTable *st, size_t capacity, double load_factor, size_t bucket_size) {
+    if (capacity == 0 || load_factor <= 0 || load_factor > 1.0) return -1;
+    if (bucket_size > TINY_PTR_MAX_BUCKET_SIZE) return -1;
+    st->requested_capacity = capacity;
+    st->load_factor = load_factor;
+    st->requested_bucket_size = bucket_size;
+    /* Choose bucket size based on capacity; enforce a minimum of 8 slots per bucket */
+    int bs = int_log2(capacity);
+    bs = bs / 2;
+    if (bs < 8) bs = 8;
+    if (bs > TINY_PTR_MAX_BUCKET_SIZE)
+        bs = TINY_PTR_MAX_BUCKET_SIZE;
+    if (bucket_size > 0)
+        bs = (int)bucket_size;
+    st->bucket_size = (size_t)bs;
+    /* Compute minimum slots so that capacity/slots <= load_factor */
+    size_t min_slots = (size_t) ceil((double) capacity / load_factor);
+    size_t desired_buckets = (min_slots + st->bucket_size - 1) / st->bucket_size;
+    st->bucket_count = next_power_of_two(desired_buckets);
+    st->total_slots = st->bucket_count * st->bucket_size;
+    /* Set the hash seed to depend on the requested capacity */
+    st->hash_seed = ((uint32_t) capacity) ^ 0x9e3779b9;
+    st->shm_base = NULL;
+    st->shm_size = 0;
+    st->shm_fd = -1;
+    st->bucket_claimed = NULL;
+    return 0;
+}
+
+/*
+ * Builds a table; with_slots 0 leaves out the key and value arrays
+ * (mask-only table), with_claims 1 adds the claim masks of a lock-free table.
+ */
+static SimpleTable* create_table(size_t capacity, double load_factor, size_t bucket_size,
+                                 int with_slots, int with_claims) {
+    SimpleTable *st = malloc(sizeof(SimpleTable));
+    if (!st) return NULL;
+    if (table_geometry(st, capacity, load_factor, bucket_size) != 0) {
+        free(st);
+        return NULL;
+    }
+    /* All-zero arrays are an empty table, so nothing is initialized here */
+    st->store = with_slots ? table_alloc(st->total_slots * sizeof(int)) : NULL;
+    st->keys = with_slots ? table_alloc(st->total_slots * sizeof(int)) : NULL;
+    st->bucket_used = table_alloc(st->bucket_count * sizeof(uint64_t));
+    st->bucket_claimed = with_claims ? table_alloc(st->bucket_count * sizeof(uint64_t)) : NULL;
+    if ((with_slots && (!st->store || !st->keys)) || !st->bucket_used || (with_claims && !st->bucket_claimed)) {
+        table_release(st->store, st->total_slots * sizeof(int));
+        table_release(st->keys, st->total_slots * sizeof(int));
+        table_release(st->bucket_used, st->bucket_count * sizeof(uint64_t));
+        table_release(st->bucket_claimed, st->bucket_count * sizeof(uint64_t));
+        free(st);
+        return NULL;
+    }
+    pthread_mutex_init(&st->mutex, NULL);
+    st->lock = &st->mutex;
+    return st;
+}
+
+/*
+ * simple_create_sized takes an explicit bucket size of 1..64 slots (0 keeps
+ * the capacity-derived default). A tiny pointer needs log2(bucket_size)
+ * bits, so going from 32 to 64 slots costs one bit per pointer but lets a
+ * table run at a much higher load factor before a bucket overflows.
+ */
+SimpleTable* simple_create_sized(size_t capacity, double load_factor, size_t bucket_size) {
+    return create_table(capacity, load_factor, bucket_size, 1, 0);
+}
+
+SimpleTable* simple_create_mask_only(size_t capacity, double load_factor) {
+    return create_table(capacity, load_factor, 0, 0, 0);
+}
+
+SimpleTable* simple_create_lock_free(size_t capacity, double load_factor) {
+    return create_table(capacity, load_factor, 0, 1, 1);
+}
+
+void simple_destroy(SimpleTable *st) {
+    if (!st) return;
+    if (st->shm_base) {
+        /* Detach only: the region and its lock outlive this process's handle */
+        munmap(st->shm_base, st->shm_size);
+        close(st->shm_fd);
+        free(st);
+        return;
+    }
+    pthread_mutex_destroy(&st->mutex);
+    table_release(st->store, st->total_slots * sizeof(int));
+    table_release(st->keys, st->total_slots * sizeof(int));
+    table_release(st->bucket_used, st->bucket_count * sizeof(uint64_t));
+    table_release(st->bucket_claimed, st->bucket_count * sizeof(uint64_t));
+    free(st);
+}
+
+/*
+ * The _unlocked primitives do the work of allocate/dereference/free without
+ * taking st's mutex. Composite variants that already serialize access to a
+ * SimpleTable with their own lock call these to avoid a second, nested lock.
+ */
+int simple_allocate_unlocked(SimpleTable *st, int key, int value) {
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    int bucket = h & (st->bucket_count - 1);
+    uint64_t free_mask = free_slots(st, st->bucket_used[bucket]);
+    int slot_offset = find_first_free(free_mask);
+    if (slot_offset < 0)
+        return -1;
+    size_t index = bucket * st->bucket_size + slot_offset;
+    __atomic_store_n(&st->keys[index], key, __ATOMIC_RELAXED);
+    __atomic_store_n(&st->store[index], value, __ATOMIC_RELEASE);  /* Pairs with the lock-free dereference */
+    /* Writers hold the lock, so a plain read-modify-write; the store is atomic for lock-free find */
+    __atomic_store_n(&st->bucket_used[bucket], st->bucket_used[bucket] | slot_bit(slot_offset), __ATOMIC_RELEASE);
+    return slot_offset;
+}
+
+/* A single atomic load, so it is also the lock-free dereference */
+int simple_dereference_unlocked(SimpleTable *st, int key, int tiny_ptr) {
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    int bucket = h & (st->bucket_count - 1);
+    return __atomic_load_n(&st->store[bucket * st->bucket_size + tiny_ptr], __ATOMIC_ACQUIRE);
+}
+
+void simple_free_unlocked(SimpleTable *st, int key, int tiny_ptr) {
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    int bucket = h & (st->bucket_count - 1);
+    __atomic_store_n(&st->bucket_used[bucket], st->bucket_used[bucket] & ~slot_bit(tiny_ptr), __ATOMIC_RELEASE);
+    __atomic_store_n(&st->store[bucket * st->bucket_size + tiny_ptr], 0, __ATOMIC_RELAXED);  // Optionally clear the value.
+}
+
+int simple_allocate(SimpleTable *st, int key, int value) {
+    if (!st) return -1;
+    table_lock(st);
+    int ret = simple_allocate_unlocked(st, key, value);
+    table_unlock(st);
+    return ret;
+}
+
+int simple_dereference(SimpleTable *st, int key, int tiny_ptr) {
+    if (!st) return -1;
+    table_lock(st);
+    int ret = simple_dereference_unlocked(st, key, tiny_ptr);
+    table_unlock(st);
+    return ret;
+}
+
+void simple_free(SimpleTable *st, int key, int tiny_ptr) {
+    if (!st) return;
+    table_lock(st);
+    simple_free_unlocked(st, key, tiny_ptr);
+    table_unlock(st);
+}
+
+/*
+ * Lookup by key: scans the key's bucket and writes the tiny pointers of up
+ * to max slots holding key, in slot order. Only occupied slots count, so
+ * stale keys left behind by a free never match. Returns the number written.
+ */
+/*
+ * Slots of bucket holding key. A slot freed and reclaimed during the scan may
+ * show its new key early, so the mask is re-read and only still-published
+ * slots are kept.
+ */
+static inline uint64_t bucket_matches(const SimpleTable *st, size_t bucket, int key) {
+    uint64_t used = __atomic_load_n(&st->bucket_used[bucket], __ATOMIC_ACQUIRE);
+    uint64_t matches = used ? key_scan(st->keys + bucket * st->bucket_size, st->bucket_size, key) & used : 0;
+    if (matches)
+        matches &= __atomic_load_n(&st->bucket_used[bucket], __ATOMIC_ACQUIRE);
+    return matches;
+}
+
+size_t simple_find_unlocked(SimpleTable *st, int key, int *out_tiny_ptrs, size_t max) {
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    uint64_t matches = bucket_matches(st, h & (st->bucket_count - 1), key);
+    size_t found = 0;
+    for (; matches && found < max; matches &= matches - 1)
+        out_tiny_ptrs[found++] = __builtin_ctzll(matches);
+    return found;
+}
+
+/* The value line is fetched while the keys are scanned, so a hit costs one miss, not two */
+int simple_lookup_unlocked(SimpleTable *st, int key, int *value) {
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    size_t bucket = h & (st->bucket_count - 1);
+    size_t base = bucket * st->bucket_size;
+    __builtin_prefetch(&st->store[base]);
+    uint64_t matches = bucket_matches(st, bucket, key);
+    if (!matches) return -1;
+    int tp = __builtin_ctzll(matches);
+    if (value) *value = __atomic_load_n(&st->store[base + tp], __ATOMIC_ACQUIRE);
+    return tp;
+}
+
+size_t simple_find(SimpleTable *st, int key, int *out_tiny_ptrs, size_t max) {
+    if (!st || (max > 0 && !out_tiny_ptrs)) return 0;
+    table_lock(st);
+    size_t found = simple_find_unlocked(st, key, out_tiny_ptrs, max);
+    table_unlock(st);
+    return found;
+}
+
+/*
+ * Dereferences n (key, tiny pointer) pairs under one lock acquisition using
+ * the dispatched batch kernel. Returns 0, or -1 on bad arguments.
+ */
+int simple_dereference_batch(SimpleTable *st, const int *keys, const int *tiny_ptrs, size_t n, int *out) {
+    if (!st || (n > 0 && (!keys || !tiny_ptrs || !out))) return -1;
+    table_lock(st);
+    dereference_kernel(st->store, st->bucket_size, st->hash_seed, (uint32_t)(st->bucket_count - 1),
+                       keys, tiny_ptrs, n, out);
+    table_unlock(st);
+    return 0;
+}
+
+/*
+ * Lock-free batch dereference for callers that keep st alive (e.g. through
+ * an epoch): keys are hashed in chunks by the dispatched kernel, then each
+ * value is read with the same atomic load as simple_dereference_unlocked.
+ */
+int simple_dereference_batch_unlocked(SimpleTable *st, const int *keys, const int *tiny_ptrs, size_t n, int *out) {
+    if (!st || (n > 0 && (!keys || !tiny_ptrs || !out))) return -1;
+    uint32_t buckets[256];
+    for (size_t i = 0; i < n; i += 256) {
+        size_t chunk = n - i < 256 ? n - i : 256;
+        hash_to_buckets(keys + i, chunk, st->hash_seed, (uint32_t)(st->bucket_count - 1), buckets);
+        for (size_t j = 0; j < chunk; j++)
+            out[i + j] = __atomic_load_n(&st->store[buckets[j] * st->bucket_size + tiny_ptrs[i + j]], __ATOMIC_ACQUIRE);
+    }
+    return 0;
+}
+
+/*
+ * Claims the first free slot of a bucket with a CAS on one of its masks,
+ * so several rehash workers can fill the same destination table without locks.
+ */
+static inline int claim_free_slot(SimpleTable *st, uint64_t *masks, size_t bucket) {
+    uint64_t used = __atomic_load_n(&masks[bucket], __ATOMIC_RELAXED);
+    for (;;) {
+        int slot_offset = find_first_free(free_slots(st, used));
+        if (slot_offset < 0)
+            return -1;
+        if (__atomic_compare_exchange_n(&masks[bucket], &used, used | slot_bit(slot_offset),
+                                        1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return slot_offset;
+    }
+}
+
+/*
+ * Lock-free allocate/free: the slot is claimed or released with a CAS on
+ * the bucket's claim mask, so any number of threads may call these (and
+ * simple_dereference_unlocked) on one table concurrently. The occupancy
+ * bit is set only after the key and value are stored, and cleared before
+ * the claim is, so a reader that sees the bit (find, lookup, cursor) also
+ * sees the slot's current key. They must not be mixed with the
+ * mutex-guarded writers (allocate, free) on the same table.
+ */
+int simple_allocate_atomic(SimpleTable *st, int key, int value) {
+    if (!st || !st->bucket_claimed) return -1;
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    size_t bucket = h & (st->bucket_count - 1);
+    int slot_offset = claim_free_slot(st, st->bucket_claimed, bucket);
+    if (slot_offset < 0)
+        return -1;
+    size_t index = bucket * st->bucket_size + slot_offset;
+    __atomic_store_n(&st->keys[index], key, __ATOMIC_RELAXED);
+    __atomic_store_n(&st->store[index], value, __ATOMIC_RELEASE);
+    __atomic_fetch_or(&st->bucket_used[bucket], slot_bit(slot_offset), __ATOMIC_RELEASE);
+    return slot_offset;
+}
+
+void simple_free_atomic(SimpleTable *st, int key, int tiny_ptr) {
+    if (!st || !st->bucket_claimed || tiny_ptr < 0 || (size_t)tiny_ptr >= st->bucket_size) return;
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    size_t bucket = h & (st->bucket_count - 1);
+    __atomic_fetch_and(&st->bucket_used[bucket], ~slot_bit(tiny_ptr), __ATOMIC_RELEASE);
+    __atomic_store_n(&st->store[bucket * st->bucket_size + tiny_ptr], 0, __ATOMIC_RELAXED);
+    __atomic_fetch_and(&st->bucket_claimed[bucket], ~slot_bit(tiny_ptr), __ATOMIC_RELEASE);
+}
+
+void simple_sync_claims(SimpleTable *st) {
+    if (!st || !st->bucket_claimed) return;
+    for (size_t b = 0; b < st->bucket_count; b++)
+        st->bucket_claimed[b] = st->bucket_used[b];
+}
+
+int simple_claim_slot(SimpleTable *st, int key) {
+    if (!st) return -1;
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    return claim_free_slot(st, st->bucket_used, h & (st->bucket_count - 1));
+}
+
+/* The release pairs with the acquire of the next claim, so the slot's old contents are settled first */
+void simple_release_slot(SimpleTable *st, int key, int tiny_ptr) {
+    if (!st || tiny_ptr < 0 || (size_t)tiny_ptr >= st->bucket_size) return;
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    size_t bucket = h & (st->bucket_count - 1);
+    __atomic_fetch_and(&st->bucket_used[bucket], ~slot_bit(tiny_ptr), __ATOMIC_RELEASE);
+}
+
+typedef struct {
+    SimpleTable *old_st;
+    SimpleTable *new_st;
+    size_t begin_bucket;   /* First old bucket of this worker's range */
+    size_t end_bucket;     /* One past the last old bucket */
+    int *failed;           /* Shared overflow flag */
+} RehashRange;
+
+/* Moves the entries of one range of old buckets into the new table. */
+TINY_PTR_CLONES
+static void* rehash_range(void *arg) {
+    RehashRange *r = arg;
+    SimpleTable *old_st = r->old_st, *new_st = r->new_st;
+    for (size_t b = next_occupied_bucket(old_st->bucket_used, r->begin_bucket, r->end_bucket);
+         b < r->end_bucket;
+         b = next_occupied_bucket(old_st->bucket_used, b + 1, r->end_bucket)) {
+        if (__atomic_load_n(r->failed, __ATOMIC_RELAXED)) break;
+        uint64_t occupied = old_st->bucket_used[b];
+        while (occupied) {
+            size_t i = b * old_st->bucket_size + __builtin_ctzll(occupied);
+            occupied &= occupied - 1;
+            int key = old_st->keys[i];
+            uint32_t h = hash_int_with_seed(key, new_st->hash_seed);
+            size_t bucket = h & (new_st->bucket_count - 1);
+            int slot_offset = claim_free_slot(new_st, new_st->bucket_used, bucket);
+            if (slot_offset < 0) {
+                __atomic_store_n(r->failed, 1, __ATOMIC_RELAXED);
+                return NULL;
+            }
+            size_t new_index = bucket * new_st->bucket_size + slot_offset;
+            new_st->store[new_index] = old_st->store[i];
+            new_st->keys[new_index] = key;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Runs fn once per element of the args array (each arg_size bytes), one
+ * thread per element. If a thread cannot be spawned, its share of the work
+ * runs on the calling thread instead.
+ */
+static void run_workers(void *(*fn)(void *), void *args, size_t arg_size, int nthreads) {
+    pthread_t *threads = nthreads > 1 ? malloc(nthreads * sizeof(pthread_t)) : NULL;
+    int started = 0;
+    for (int t = 0; t < nthreads; t++) {
+        void *arg = (char *)args + t * arg_size;
+        if (threads && pthread_create(&threads[started], NULL, fn, arg) == 0)
+            started++;
+        else
+            fn(arg);
+    }
+    for (int t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+    free(threads);
+}
+
+/*
+ * Moves every allocated entry of old_st into new_st, splitting the old
+ * buckets into nthreads contiguous ranges. Returns 0 on success, or -1 if
+ * a bucket of new_st overflowed.
+ */
+static int rehash_entries(SimpleTable *old_st, SimpleTable *new_st, int nthreads) {
+    int failed = 0;
+    if (nthreads < 1) nthreads = 1;
+    if ((size_t)nthreads > old_st->bucket_count) nthreads = (int)old_st->bucket_count;
+    RehashRange *ranges = malloc(nthreads * sizeof(RehashRange));
+    if (!ranges) {
+        if (nthreads == 1) return -1;
+        return rehash_entries(old_st, new_st, 1);
+    }
+    size_t chunk = (old_st->bucket_count + nthreads - 1) / nthreads;
+    for (int t = 0; t < nthreads; t++) {
+        size_t begin = t * chunk;
+        size_t end = begin + chunk;
+        if (begin > old_st->bucket_count) begin = old_st->bucket_count;
+        if (end > old_st->bucket_count) end = old_st->bucket_count;
+        ranges[t] = (RehashRange){ old_st, new_st, begin, end, &failed };
+    }
+    run_workers(rehash_range, ranges, sizeof(RehashRange), nthreads);
+    free(ranges);
+    return failed ? -1 : 0;
+}
+
+/*
+ * Bulk loading works in three parallel passes over the input:
+ *   1. hash every key to its bucket and count items per partition,
+ *   2. scatter item indices into partition order (stable),
+ *   3. fill each partition, which owns a contiguous range of buckets.
+ * Partitions never share a bucket, so the fill pass needs no locks or
+ * atomics, and items of one bucket are placed in input order.
+ */
+typedef struct {
+    SimpleTable *st;
+    const int *keys;
+    const int *values;
+    int *out;
+    uint32_t *bucket_of;     /* Destination bucket of each item */
+    size_t *order;           /* Item indices grouped by partition */
+    size_t *part_start;      /* partition_count + 1 offsets into order */
+    size_t *cursor;          /* Per-partition write cursor of this worker */
+    size_t item_begin, item_end;
+    size_t part_begin, part_end;
+    size_t partition_count;
+    int partition_shift;
+    size_t placed;
+} BulkWorker;
+
+static void* bulk_hash_pass(void *arg) {
+    BulkWorker *w = arg;
+    SimpleTable *st = w->st;
+    hash_to_buckets(w->keys + w->item_begin, w->item_end - w->item_begin, st->hash_seed,
+                    (uint32_t)(st->bucket_count - 1), w->bucket_of + w->item_begin);
+    for (size_t i = w->item_begin; i < w->item_end; i++)
+        w->cursor[w->bucket_of[i] >> w->partition_shift]++;
+    return NULL;
+}
+
+static void* bulk_scatter_pass(void *arg) {
+    BulkWorker *w = arg;
+    for (size_t i = w->item_begin; i < w->item_end; i++)
+        w->order[w->cursor[w->bucket_of[i] >> w->partition_shift]++] = i;
+    return NULL;
+}
+
+TINY_PTR_CLONES
+static void* bulk_fill_pass(void *arg) {
+    BulkWorker *w = arg;
+    SimpleTable *st = w->st;
+    for (size_t k = w->part_start[w->part_begin]; k < w->part_start[w->part_end]; k++) {
+        size_t i = w->order[k];
+        uint32_t bucket = w->bucket_of[i];
+        uint64_t free_mask = free_slots(st, st->bucket_used[bucket]);
+        if (free_mask == 0) {
+            w->out[i] = -1;
+            continue;
+        }
+        int slot_offset = find_first_free(free_mask);
+        st->bucket_used[bucket] |= slot_bit(slot_offset);
+        size_t index = (size_t)bucket * st->bucket_size + slot_offset;
+        st->store[index] = w->values[i];
+        st->keys[index] = w->keys[i];
+        w->out[i] = slot_offset;
+        w->placed++;
+    }
+    return NULL;
+}
+
+/* Single-threaded bulk load: a plain loop already fills buckets in input order. */
+TINY_PTR_CLONES
+static size_t bulk_load_serial(SimpleTable *st, const int *keys, const int *values, size_t n, int *out) {
+    size_t placed = 0;
+    for (size_t i = 0; i < n; i++) {
+        int bucket = hash_int_with_seed(keys[i], st->hash_seed) & (st->bucket_count - 1);
+        uint64_t free_mask = free_slots(st, st->bucket_used[bucket]);
+        if (free_mask == 0) {
+            out[i] = -1;
+            continue;
+        }
+        int slot_offset = find_first_free(free_mask);
+        st->bucket_used[bucket] |= slot_bit(slot_offset);
+        size_t index = bucket * st->bucket_size + slot_offset;
+        st->store[index] = values[i];
+        st->keys[index] = keys[i];
+        out[i] = slot_offset;
+        placed++;
+    }
+    return placed;
+}
+
+static size_t bulk_load_parallel(SimpleTable *st, const int *keys, const int *values, size_t n,
+                                 int *out, int nthreads) {
+    /* One partition per worker, rounded up to a power of two bucket range */
+    size_t partition_count = next_power_of_two((size_t)nthreads);
+    if (partition_count > st->bucket_count) partition_count = st->bucket_count;
+    int partition_shift = int_log2((int)st->bucket_count) - int_log2((int)partition_count);
+
+    BulkWorker *workers = calloc(nthreads, sizeof(BulkWorker));
+    size_t *cursors = calloc((size_t)nthreads * partition_count, sizeof(size_t));
+    size_t *part_start = calloc(partition_count + 1, sizeof(size_t));
+    uint32_t *bucket_of = malloc(n * sizeof(uint32_t));
+    size_t *order = malloc(n * sizeof(size_t));
+    if (!workers || !cursors || !part_start || !bucket_of || !order) {
+        free(workers); free(cursors); free(part_start); free(bucket_of); free(order);
+        return bulk_load_serial(st, keys, values, n, out);
+    }
+
+    size_t item_chunk = (n + nthreads - 1) / nthreads;
+    size_t part_chunk = (partition_count + nthreads - 1) / nthreads;
+    for (int t = 0; t < nthreads; t++) {
+        BulkWorker *w = &workers[t];
+        w->st = st;
+        w->keys = keys;
+        w->values = values;
+        w->out = out;
+        w->bucket_of = bucket_of;
+        w->order = order;
+        w->part_start = part_start;
+        w->cursor = &cursors[(size_t)t * partition_count];
+        w->item_begin = t * item_chunk < n ? t * item_chunk : n;
+        w->item_end = w->item_begin + item_chunk < n ? w->item_begin + item_chunk : n;
+        w->part_begin = t * part_chunk < partition_count ? t * part_chunk : partition_count;
+        w->part_end = w->part_begin + part_chunk < partition_count ? w->part_begin + part_chunk : partition_count;
+        w->partition_count = partition_count;
+        w->partition_shift = partition_shift;
+    }
+    run_workers(bulk_hash_pass, workers, sizeof(BulkWorker), nthreads);
+
+    /* Turn per-worker counts into write cursors: partition-major, worker-minor. */
+    size_t offset = 0;
+    for (size_t p = 0; p < partition_count; p++) {
+        part_start[p] = offset;
+        for (int t = 0; t < nthreads; t++) {
+            size_t count = workers[t].cursor[p];
+            workers[t].cursor[p] = offset;
+            offset += count;
+        }
+    }
+    part_start[partition_count] = offset;
+
+    run_workers(bulk_scatter_pass, workers, sizeof(BulkWorker), nthreads);
+    run_workers(bulk_fill_pass, workers, sizeof(BulkWorker), nthreads);
+
+    size_t placed = 0;
+    for (int t = 0; t < nthreads; t++)
+        placed += workers[t].placed;
+    free(workers); free(cursors); free(part_start); free(bucket_of); free(order);
+    return placed;
+}
+
+/*
+ * simple_bulk_load inserts n key/value pairs and writes the tiny pointer of
+ * pair i to out_tiny_ptrs[i] (-1 if its bucket overflowed). Returns the
+ * number of pairs placed. The table is locked for the whole load.
+ */
+size_t simple_bulk_load(SimpleTable *st, const int *keys, const int *values, size_t n,
+                        int *out_tiny_ptrs, int nthreads) {
+    if (!st || (n > 0 && (!keys || !values || !out_tiny_ptrs))) return 0;
+    if (nthreads < 1) nthreads = 1;
+    if ((size_t)nthreads > n) nthreads = n > 0 ? (int)n : 1;
+    table_lock(st);
+    size_t placed = nthreads == 1
+        ? bulk_load_serial(st, keys, values, n, out_tiny_ptrs)
+        : bulk_load_parallel(st, keys, values, n, out_tiny_ptrs, nthreads);
+    table_unlock(st);
+    return placed;
+}
+
+/*
+ * simple_resize creates a new SimpleTable with new_capacity and the same load factor,
+ * rehashes all allocated entries from the old table into the new table,
+ * and destroys the old table.
+ */
+SimpleTable* simple_resize(SimpleTable *old_st, size_t new_capacity) {
+    return simple_resize_parallel(old_st, new_capacity, 1);
+}
+
+/*
+ * Same as simple_resize, but the rehash is spread over nthreads workers,
+ * each owning a contiguous range of old buckets.
+ */
+SimpleTable* simple_resize_parallel(SimpleTable *old_st, size_t new_capacity, int nthreads) {
+    if (!old_st || old_st->shm_base) return NULL;
+    SimpleTable *new_st = simple_create_sized(new_capacity, old_st->load_factor, old_st->requested_bucket_size);
+    if (!new_st) return NULL;
+
+    table_lock(old_st);
+    table_lock(new_st);
+    int rc = rehash_entries(old_st, new_st, nthreads);
+    table_unlock(new_st);
+    table_unlock(old_st);
+    if (rc != 0) {
+        simple_destroy(new_st);
+        return NULL;
+    }
+    simple_destroy(old_st);
+    return new_st;
+}
+
+/*
+ * simple_rehash builds a resized copy of old_st and leaves old_st intact.
+ * The old table is not locked, so concurrent dereferences keep running;
+ * the caller must keep allocate/free off old_st until it is retired.
+ */
+SimpleTable* simple_rehash(SimpleTable *old_st, size_t new_capacity) {
+    return simple_rehash_parallel(old_st, new_capacity, 1);
+}
+
+SimpleTable* simple_rehash_parallel(SimpleTable *old_st, size_t new_capacity, int nthreads) {
+    if (!old_st) return NULL;
+    SimpleTable *new_st = simple_create_sized(new_capacity, old_st->load_factor, old_st->requested_bucket_size);
+    if (!new_st) return NULL;
+    if (rehash_entries(old_st, new_st, nthreads) != 0) {
+        simple_destroy(new_st);
+        return NULL;
+    }
+    return new_st;
+}
+
+size_t simple_live_count(const SimpleTable *st) {
+    if (!st) return 0;
+    size_t live = 0;
+    for (size_t b = 0; b < st->bucket_count; b++)
+        live += __builtin_popcountll(st->bucket_used[b]);
+    return live;
+}
+
+size_t simple_memory_usage(const SimpleTable *st) {
+    if (!st) return 0;
+    size_t slot_bytes = (st->store ? sizeof(int) : 0) + (st->keys ? sizeof(int) : 0);
+    size_t mask_bytes = (st->bucket_claimed ? 2 : 1) * sizeof(uint64_t);
+    return sizeof(SimpleTable) + st->total_slots * slot_bytes + st->bucket_count * mask_bytes;
+}
+
+int simple_geometry(const SimpleTable *st, SimpleGeometry *out) {
+    if (!st || !out) return -1;
+    out->capacity = st->requested_capacity;
+    out->load_factor = st->load_factor;
+    out->bucket_count = st->bucket_count;
+    out->bucket_size = st->bucket_size;
+    out->hash_seed = st->hash_seed;
+    return 0;
+}
+
+size_t simple_slot_index(const SimpleTable *st, int key, int tiny_ptr) {
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    return (h & (st->bucket_count - 1)) * st->bucket_size + (size_t)tiny_ptr;
+}
+
+/*
+ * Restores an entry at a known tiny pointer, e.g. when copying a table
+ * with the same geometry. Returns 0, or -1 if the slot is taken.
+ */
+int simple_insert_at(SimpleTable *st, int key, int value, int tiny_ptr) {
+    if (!st || tiny_ptr < 0 || (size_t)tiny_ptr >= st->bucket_size) return -1;
+    table_lock(st);
+    uint32_t h = hash_int_with_seed(key, st->hash_seed);
+    size_t bucket = h & (st->bucket_count - 1);
+    int ret = -1;
+    if (!(st->bucket_used[bucket] & slot_bit(tiny_ptr))) {
+        size_t index = bucket * st->bucket_size + tiny_ptr;
+        st->store[index] = value;
+        st->keys[index] = key;
+        st->bucket_used[bucket] |= slot_bit(tiny_ptr);
+        ret = 0;
+    }
+    table_unlock(st);
+    return ret;
+}
+
+/*
+ * simple_visit walks the occupied bits of every bucket mask, so empty
+ * slots are never touched. The table is not locked; the caller must keep
+ * allocate/free off it for the duration of the walk.
+ */
+void simple_visit(SimpleTable *st, simple_visit_fn fn, void *ctx) {
+    if (!st || !fn) return;
+    for (size_t b = next_occupied_bucket(st->bucket_used, 0, st->bucket_count);
+         b < st->bucket_count;
+         b = next_occupied_bucket(st->bucket_used, b + 1, st->bucket_count)) {
+        uint64_t occupied = st->bucket_used[b];
+        while (occupied) {
+            int slot_offset = __builtin_ctzll(occupied);
+            size_t index = b * st->bucket_size + slot_offset;
+            fn(ctx, st->keys[index], st->store[index], slot_offset);
+            occupied &= occupied - 1;
+        }
+    }
+}
+
+void simple_cursor_init(const SimpleTable *st, SimpleCursor *cur, size_t begin_bucket, size_t end_bucket) {
+    if (!cur) return;
+    size_t count = st ? st->bucket_count : 0;
+    cur->bucket = begin_bucket < count ? begin_bucket : count;
+    cur->end_bucket = end_bucket < count ? end_bucket : count;
+    cur->pending = 0;
+}
+
+void simple_cursor_part(const SimpleTable *st, SimpleCursor *cur, size_t part, size_t parts) {
+    size_t count = st ? st->bucket_count : 0;
+    if (parts == 0 || part >= parts) {
+        simple_cursor_init(st, cur, count, count);
+        return;
+    }
+    simple_cursor_init(st, cur, count / parts * part + count % parts * part / parts,
+                       count / parts * (part + 1) + count % parts * (part + 1) / parts);
+}
+
+/*
+ * The mask is read before and after the slots are copied, and only slots
+ * set both times are kept, so a slot freed meanwhile is dropped. Values
+ * are loaded with acquire before keys, pairing with the release store of
+ * the atomic allocate.
+ */
+int simple_cursor_fill(SimpleTable *st, SimpleCursor *cur) {
+    if (!st || !cur) return 0;
+    if (cur->pending) return 1;
+    while (cur->bucket < cur->end_bucket) {
+        size_t b = next_occupied_bucket(st->bucket_used, cur->bucket, cur->end_bucket);
+        if (b >= cur->end_bucket) break;
+        cur->bucket = b + 1;
+        size_t base = b * st->bucket_size;
+        uint64_t before = __atomic_load_n(&st->bucket_used[b], __ATOMIC_ACQUIRE);
+        for (uint64_t m = before; m; m &= m - 1) {
+            int slot = __builtin_ctzll(m);
+            cur->values[slot] = __atomic_load_n(&st->store[base + slot], __ATOMIC_ACQUIRE);
+            cur->keys[slot] = __atomic_load_n(&st->keys[base + slot], __ATOMIC_RELAXED);
+        }
+        cur->pending = before & __atomic_load_n(&st->bucket_used[b], __ATOMIC_ACQUIRE);
+        if (cur->pending) return 1;
+    }
+    cur->bucket = cur->end_bucket;
+    return 0;
+}
+
+int simple_cursor_next_unlocked(SimpleTable *st, SimpleCursor *cur, int *key, int *value, int *tiny_ptr) {
+    if (!simple_cursor_fill(st, cur)) return 0;
+    int slot = __builtin_ctzll(cur->pending);
+    cur->pending &= cur->pending - 1;
+    if (key) *key = cur->keys[slot];
+    if (value) *value = cur->values[slot];
+    if (tiny_ptr) *tiny_ptr = slot;
+    return 1;
+}
+
+/* The lock is taken only to copy the next bucket, never per entry */
+int simple_cursor_next(SimpleTable *st, SimpleCursor *cur, int *key, int *value, int *tiny_ptr) {
+    if (!st || !cur) return 0;
+    if (!cur->pending) {
+        table_lock(st);
+        int more = simple_cursor_fill(st, cur);
+        table_unlock(st);
+        if (!more) return 0;
+    }
+    return simple_cursor_next_unlocked(st, cur, key, value, tiny_ptr);
+}
+
+typedef struct {
+    int key;
+    int value;
+    int tiny_ptr;
+} CompactEntry;
+
+typedef struct {
+    CompactEntry *entries;
+    size_t count;
+} CompactCollector;
+
+static void collect_entry(void *ctx, int key, int value, int tiny_ptr) {
+    CompactCollector *c = ctx;
+    c->entries[c->count++] = (CompactEntry){ key, value, tiny_ptr };
+}
+
+/* Places the collected entries into new_st, recording their new tiny pointers. */
+static int place_entries(SimpleTable *new_st, const CompactEntry *entries, size_t n, int *new_tps) {
+    for (size_t i = 0; i < n; i++) {
+        int bucket = hash_int_with_seed(entries[i].key, new_st->hash_seed) & (new_st->bucket_count - 1);
+        uint64_t free_mask = free_slots(new_st, new_st->bucket_used[bucket]);
+        if (free_mask == 0)
+            return -1;
+        int slot_offset = find_first_free(free_mask);
+        new_st->bucket_used[bucket] |= slot_bit(slot_offset);
+        size_t index = bucket * new_st->bucket_size + slot_offset;
+        new_st->store[index] = entries[i].value;
+        new_st->keys[index] = entries[i].key;
+        new_tps[i] = slot_offset;
+    }
+    return 0;
+}
+
+/*
+ * simple_compact rebuilds st at the smallest size that holds its live
+ * entries. It starts from a table sized for exactly the live count and
+ * grows 25% per attempt whenever a bucket overflows. Returns the new table,
+ * or NULL if no smaller table fits (st is left untouched either way).
+ * remap, if given, is called for every entry whose tiny pointer changed.
+ * Like simple_rehash, st is not locked.
+ */
+SimpleTable* simple_compact(SimpleTable *st, tiny_ptr_remap_fn remap, void *ctx) {
+    if (!st) return NULL;
+    size_t live = simple_live_count(st);
+    CompactCollector collector = { malloc((live ? live : 1) * sizeof(CompactEntry)), 0 };
+    int *new_tps = malloc((live ? live : 1) * sizeof(int));
+    if (!collector.entries || !new_tps) {
+        free(collector.entries); free(new_tps);
+        return NULL;
+    }
+    simple_visit(st, collect_entry, &collector);
+
+    SimpleTable *new_st = NULL;
+    size_t target = live ? live : 1;
+    for (;;) {
+        new_st = simple_create_sized(target, st->load_factor, st->requested_bucket_size);
+        if (!new_st || new_st->total_slots >= st->total_slots) {
+            simple_destroy(new_st);
+            new_st = NULL;
+            break;
+        }
+        if (place_entries(new_st, collector.entries, live, new_tps) == 0)
+            break;
+        simple_destroy(new_st);
+        target += target / 4 + 1;
+    }
+    if (new_st && remap) {
+        for (size_t i = 0; i < live; i++) {
+            if (new_tps[i] != collector.entries[i].tiny_ptr)
+                remap(ctx, collector.entries[i].key, collector.entries[i].tiny_ptr, new_tps[i]);
+        }
+    }
+    free(collector.entries);
+    free(new_tps);
+    return new_st;
+}
+
+/*
+ * Frozen image of a SimpleTable: a position-independent, read-only copy
+ * with no keys and no free slots.
+ *
+ *   FrozenSimpleHeader
+ *   uint64_t used[]    occupancy, bucket_size bits per bucket back to back
+ *   uint32_t rank[]    entries before each run of FROZEN_RANK_WORDS words, padded to 8 bytes
+ *   packed values      value_bits each, stored as value - value_base
+ *
+ * A slot's dense index is rank[slot / 512] plus the set bits before it in
+ * its run, so occupancy costs about 1.06 bits per slot.
+ */
+#define FROZEN_RANK_WORDS 8
+
+typedef struct {
+    uint32_t hash_seed;
+    uint32_t bucket_size;
+    uint64_t bucket_count;
+    uint32_t value_bits;
+    int32_t value_base;
+    uint64_t live;
+} FrozenSimpleHeader;
+
+/* Word counts of the used and rank arrays, and the byte size of the whole image */
+static void frozen_layout(const FrozenSimpleHeader *h, size_t *used_words, size_t *rank_words, size_t *size) {
+    *used_words = (size_t)((h->bucket_count * h->bucket_size + 63) / 64);
+    size_t ranks = (*used_words + FROZEN_RANK_WORDS - 1) / FROZEN_RANK_WORDS;
+    *rank_words = (ranks + 1) / 2;
+    /* Values are read with 8-byte loads, so pad the packed array by 8 bytes */
+    size_t value_bytes = (size_t)((h->live * h->value_bits + 63) / 64) * 8 + 8;
+    *size = sizeof(FrozenSimpleHeader) + (*used_words + *rank_words) * sizeof(uint64_t) + value_bytes;
+}
+
+void* simple_freeze(SimpleTable *st, size_t *out_size) {
+    if (!st || !out_size) return NULL;
+    table_lock(st);
+    size_t live = simple_live_count(st);
+    int min = 0, max = 0;
+    int first = 1;
+    for (size_t b = next_occupied_bucket(st->bucket_used, 0, st->bucket_count);
+         b < st->bucket_count;
+         b = next_occupied_bucket(st->bucket_used, b + 1, st->bucket_count)) {
+        for (uint64_t occupied = st->bucket_used[b]; occupied; occupied &= occupied - 1) {
+            int v = st->store[b * st->bucket_size + __builtin_ctzll(occupied)];
+            if (first || v < min) min = v;
+            if (first || v > max) max = v;
+            first = 0;
+        }
+    }
+    /* Ranks are 32 bits wide */
+    if (live > UINT32_MAX) {
+        table_unlock(st);
+        return NULL;
+    }
+    uint32_t span = (uint32_t)max - (uint32_t)min;
+    uint32_t bits = 0;
+    while (bits < 32 && (span >> bits) != 0)
+        bits++;
+    FrozenSimpleHeader header = {st->hash_seed, (uint32_t)st->bucket_size, st->bucket_count, bits, min, live};
+    size_t used_words, rank_words, size;
+    frozen_layout(&header, &used_words, &rank_words, &size);
+    unsigned char *image = calloc(1, size);
+    if (!image) {
+        table_unlock(st);
+        return NULL;
+    }
+    memcpy(image, &header, sizeof(header));
+    uint64_t *used = (uint64_t *)(image + sizeof(FrozenSimpleHeader));
+    uint32_t *ranks = (uint32_t *)(used + used_words);
+    uint64_t *values = (uint64_t *)(used + used_words + rank_words);
+    uint64_t rank = 0;
+    for (size_t b = 0; b < st->bucket_count; b++) {
+        for (uint64_t occupied = st->bucket_used[b]; occupied; occupied &= occupied - 1) {
+            uint64_t slot = b * st->bucket_size + __builtin_ctzll(occupied);
+            used[slot / 64] |= slot_bit(slot % 64);
+            uint64_t v = (uint32_t)(st->store[slot] - min);
+            uint64_t bit = rank * bits;
+            if (bits > 0) {
+                values[bit / 64] |= v << (bit % 64);
+                if (bit % 64 + bits > 64)
+                    values[bit / 64 + 1] |= v >> (64 - bit % 64);
+            }
+            rank++;
+        }
+    }
+    table_unlock(st);
+    rank = 0;
+    for (size_t w = 0; w < used_words; w++) {
+        if (w % FROZEN_RANK_WORDS == 0)
+            ranks[w / FROZEN_RANK_WORDS] = (uint32_t)rank;
+        rank += __builtin_popcountll(used[w]);
+    }
+    *out_size = size;
+    return image;
+}
+
+/*
+ * Validates an image that starts at an 8-byte aligned address and has
+ * size bytes available: geometry, array sizes and every rank are checked,
+ * so dereferences against it stay in bounds. Returns the image's own
+ * size, or 0 if it is malformed.
+ */
+size_t simple_frozen_check(const void *image, size_t size) {
+    if (!image || size < sizeof(FrozenSimpleHeader)) return 0;
+    const FrozenSimpleHeader *h = image;
+    if (h->bucket_size == 0 || h->bucket_size > TINY_PTR_MAX_BUCKET_SIZE) return 0;
+    /* Every bucket takes at least one bit, which also keeps the sizes below from overflowing */
+    if (h->bucket_count == 0 || (h->bucket_count & (h->bucket_count - 1)) != 0 ||
+        h->bucket_count > (uint64_t)size * 8)
+        return 0;
+    if (h->value_bits > 32 || h->live > UINT32_MAX || h->live > h->bucket_count * h->bucket_size) return 0;
+    size_t used_words, rank_words, image_size;
+    frozen_layout(h, &used_words, &rank_words, &image_size);
+    if (image_size > size) return 0;
+    const uint64_t *used = (const uint64_t *)(h + 1);
+    const uint32_t *ranks = (const uint32_t *)(used + used_words);
+    uint64_t slots = h->bucket_count * h->bucket_size;
+    if (slots % 64 != 0 && (used[used_words - 1] >> (slots % 64)) != 0) return 0;
+    uint64_t rank = 0;
+    for (size_t w = 0; w < used_words; w++) {
+        if (w % FROZEN_RANK_WORDS == 0 && ranks[w / FROZEN_RANK_WORDS] != rank) return 0;
+        rank += __builtin_popcountll(used[w]);
+    }
+    return rank == h->live ? image_size : 0;
+}
+
+/*
+ * Lock-free dereference of a frozen image: one hash, one occupancy load,
+ * up to FROZEN_RANK_WORDS popcounts and one unaligned load of the packed
+ * value. A slot that was free when the table was frozen reads as 0, like a
+ * freed slot of a live table.
+ */
+int simple_frozen_dereference(const void *image, int key, int tiny_ptr) {
+    if (!image) return -1;
+    const FrozenSimpleHeader *h = image;
+    if (tiny_ptr < 0 || (uint32_t)tiny_ptr >= h->bucket_size) return -1;
+    size_t used_words, rank_words, size;
+    frozen_layout(h, &used_words, &rank_words, &size);
+    const uint64_t *used = (const uint64_t *)(h + 1);
+    const uint32_t *ranks = (const uint32_t *)(used + used_words);
+    const unsigned char *values = (const unsigned char *)(used + used_words + rank_words);
+    uint64_t bucket = hash_int_with_seed(key, h->hash_seed) & (h->bucket_count - 1);
+    uint64_t slot = bucket * h->bucket_size + (uint64_t)tiny_ptr;
+    uint64_t bit = slot_bit(slot % 64);
+    if (!(used[slot / 64] & bit)) return 0;
+    if (h->value_bits == 0) return h->value_base;
+    uint64_t index = ranks[slot / 64 / FROZEN_RANK_WORDS];
+    for (size_t w = slot / 64 / FROZEN_RANK_WORDS * FROZEN_RANK_WORDS; w < slot / 64; w++)
+        index += __builtin_popcountll(used[w]);
+    index = (index + __builtin_popcountll(used[slot / 64] & (bit - 1))) * h->value_bits;
+    uint64_t word;
+    memcpy(&word, values + index / 8, sizeof(word));
+    uint32_t v = (uint32_t)(word >> (index % 8)) & (uint32_t)((slot_bit(h->value_bits)) - 1);
+    return (int)((uint32_t)h->value_base + v);
+}
+
+/*
+ * Shared tables live in one region: a header holding the geometry, the
+ * process-shared lock and the offsets of the three arrays, followed by the
+ * arrays themselves. Only offsets are stored in the region; every process
+ * rebuilds its own SimpleTable handle around its own mapping.
+ */
+#define SHARED_MAGIC 0x4853505450594e54ULL  /* "TNYPTPSH" */
+#define SHARED_VERSION 1
+#define SHARED_ALIGN 64
+
+typedef struct {
+    uint64_t magic;             /* Written last by the creator */
+    uint32_t version;
+    uint32_t hash_seed;
+    uint64_t region_size;
+    uint64_t requested_capacity;
+    uint64_t requested_bucket_size;
+    uint64_t bucket_count;
+    uint64_t bucket_size;
+    double load_factor;
+    uint64_t store_offset;
+    uint64_t keys_offset;
+    uint64_t used_offset;
+    pthread_mutex_t mutex;      /* PTHREAD_PROCESS_SHARED, robust */
+} SharedSimpleHeader;
+
+static size_t shared_align(size_t x) {
+    return (x + SHARED_ALIGN - 1) & ~(size_t)(SHARED_ALIGN - 1);
+}
+
+/* Points the handle's arrays and lock into a mapped region. */
+static void shared_bind(SimpleTable *st, void *base, size_t size, int fd) {
+    SharedSimpleHeader *h = base;
+    st->store = (int *)((char *)base + h->store_offset);
+    st->keys = (int *)((char *)base + h->keys_offset);
+    st->bucket_used = (uint64_t *)((char *)base + h->used_offset);
+    st->lock = &h->mutex;
+    st->shm_base = base;
+    st->shm_size = size;
+    st->shm_fd = fd;
+}
+
+/*
+ * simple_create_shared places a new table in POSIX shared memory: the
+ * object called name (created exclusively), or an anonymous memfd when
+ * name is NULL, to be passed to other processes by descriptor. The region
+ * is sized with ftruncate, so like a private table it is all zeros and
+ * commits pages only when they are first written.
+ */
+SimpleTable* simple_create_shared(const char *name, size_t capacity, double load_factor) {
+    SimpleTable *st = malloc(sizeof(SimpleTable));
+    if (!st) return NULL;
+    if (table_geometry(st, capacity, load_factor, 0) != 0) {
+        free(st);
+        return NULL;
+    }
+    size_t store_offset = shared_align(sizeof(SharedSimpleHeader));
+    size_t keys_offset = store_offset + shared_align(st->total_slots * sizeof(int));
+    size_t used_offset = keys_offset + shared_align(st->total_slots * sizeof(int));
+    size_t size = used_offset + shared_align(st->bucket_count * sizeof(uint64_t));
+    int fd = name ? shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600)
+                  : memfd_create("tiny_ptr_simple", MFD_CLOEXEC);
+    if (fd < 0) {
+        free(st);
+        return NULL;
+    }
+    void *base = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0)
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        if (name) shm_unlink(name);
+        free(st);
+        return NULL;
+    }
+    SharedSimpleHeader *h = base;
+    h->version = SHARED_VERSION;
+    h->hash_seed = st->hash_seed;
+    h->region_size = size;
+    h->requested_capacity = st->requested_capacity;
+    h->requested_bucket_size = st->requested_bucket_size;
+    h->bucket_count = st->bucket_count;
+    h->bucket_size = st->bucket_size;
+    h->load_factor = st->load_factor;
+    h->store_offset = store_offset;
+    h->keys_offset = keys_offset;
+    h->used_offset = used_offset;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&h->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    __atomic_store_n(&h->magic, SHARED_MAGIC, __ATOMIC_RELEASE);
+    shared_bind(st, base, size, fd);
+    return st;
+}
+
+/* Attaches to a region set up by simple_create_shared; takes ownership of fd. */
+SimpleTable* simple_attach_shared_fd(int fd) {
+    if (fd < 0) return NULL;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(SharedSimpleHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)sb.st_size;
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    SimpleTable *st = base == MAP_FAILED ? NULL : malloc(sizeof(SimpleTable));
+    SharedSimpleHeader *h = base;
+    if (!st || __atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != SHARED_MAGIC ||
+        h->version != SHARED_VERSION || h->region_size != size ||
+        table_geometry(st, h->requested_capacity, h->load_factor, h->requested_bucket_size) != 0 ||
+        st->bucket_count != h->bucket_count || st->bucket_size != h->bucket_size) {
+        free(st);
+        if (base != MAP_FAILED) munmap(base, size);
+        close(fd);
+        return NULL;
+    }
+    st->hash_seed = h->hash_seed;
+    shared_bind(st, base, size, fd);
+    return st;
+}
+
+SimpleTable* simple_attach_shared(const char *name) {
+    if (!name) return NULL;
+    return simple_attach_shared_fd(shm_open(name, O_RDWR, 0));
+}
+
+int simple_shared_fd(const SimpleTable *st) {
+    return st ? st->shm_fd : -1;
+}
+
+int simple_is_shared(const SimpleTable *st) {
+    return st && st->shm_base != NULL;
+}
+
+int simple_unlink_shared(const char *name) {
+    return name && shm_unlink(name) == 0 ? 0 : -1;
+}
+
+/* 
+ * Alias for legacy code: simple_create calls simple_create_ex with default load factor 0.9.
+ */
+SimpleTable* simple_create(size_t capacity) {
+    return simple_create_ex(capacity, 0.9);
+}
@@ -0,0 +1,198 @@
+#include "tiny_ptr_tune.h"
+#include "tiny_ptr_sharded.h"
+#include <stdlib.h>
+
+/* Candidate grids; every combination of a variant's parameters is simulated */
+static const double tune_load_factors[] = {0.5, 0.6, 0.7, 0.75, 0.8, 0.85, 0.9, 0.95, 1.0};
+static const size_t tune_bucket_sizes[] = {8, 16, 32, 64};
+static const double tune_primary_fractions[] = {0.75, 0.8, 0.85, 0.9, 0.95};
+static const size_t tune_level_counts[] = {1, 2, 3, 4, 6, 8, 12, 16};
+static const size_t tune_container_counts[] = {1, 4, 16, 64};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+/* One operation, ordered by key and then by position in the workload */
+typedef struct {
+    int key;
+    size_t index;
+} TuneRef;
+
+static int compare_refs(const void *a, const void *b) {
+    const TuneRef *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+/*
+ * Pairs every free with the latest live allocation of its key (pair[i] is
+ * that allocation's op index) and returns the peak live count, or 0 if a
+ * free has nothing to release. The ops are sorted by key, so each key's
+ * allocations and frees are matched with a stack in workload order.
+ */
+static size_t pair_workload(const TinyPtrOp *ops, size_t n, size_t *pair) {
+    TuneRef *refs = malloc(n * sizeof(TuneRef));
+    size_t *stack = malloc(n * sizeof(size_t));
+    if (!refs || !stack) {
+        free(refs);
+        free(stack);
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++)
+        refs[i] = (TuneRef){ ops[i].key, i };
+    qsort(refs, n, sizeof(TuneRef), compare_refs);
+    int ok = 1;
+    for (size_t g = 0; g < n && ok; ) {
+        size_t top = 0, h = g;
+        for (; h < n && refs[h].key == refs[g].key && ok; h++) {
+            size_t i = refs[h].index;
+            if (!ops[i].is_free)
+                stack[top++] = i;
+            else if (top == 0)
+                ok = 0;
+            else
+                pair[i] = stack[--top];
+        }
+        g = h;
+    }
+    free(refs);
+    free(stack);
+    if (!ok) return 0;
+    size_t live = 0, peak = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!ops[i].is_free) {
+            if (++live > peak) peak = live;
+        } else {
+            live--;
+        }
+    }
+    return peak;
+}
+
+/* Replay the workload against ut; returns the number of failed allocations */
+static size_t replay(tiny_ptr_table_t *ut, const TinyPtrOp *ops, size_t n, const size_t *pair, int *tps) {
+    size_t failures = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!ops[i].is_free) {
+            tps[i] = tiny_ptr_allocate(ut, ops[i].key, ops[i].key);
+            if (tps[i] < 0) failures++;
+        } else if (tps[pair[i]] >= 0) {
+            tiny_ptr_free(ut, ops[i].key, tps[pair[i]]);
+        }
+    }
+    return failures;
+}
+
+typedef struct {
+    const TinyPtrOp *ops;
+    size_t n;
+    const size_t *pair;
+    int *tps;
+    size_t allocations;
+    size_t allowed_failures;
+    int found;
+    TinyPtrConfig best;
+    TinyPtrTuneReport report;
+} Tuner;
+
+/* Simulate one candidate unless a cheaper passing one is already known */
+static void try_candidate(Tuner *t, const TinyPtrConfig *candidate) {
+    tiny_ptr_table_t *ut = tiny_ptr_create_config(candidate);
+    if (!ut) return;
+    size_t bytes = tiny_ptr_memory_usage(ut);
+    if (!t->found || bytes < t->report.memory_bytes) {
+        t->report.candidates++;
+        size_t failures = replay(ut, t->ops, t->n, t->pair, t->tps);
+        if (failures <= t->allowed_failures) {
+            t->found = 1;
+            t->best = *candidate;
+            t->report.failures = failures;
+            t->report.memory_bytes = bytes;
+        }
+    }
+    tiny_ptr_destroy(ut);
+}
+
+static void tune_candidates(Tuner *t, TinyPtrVariant variant, size_t capacity) {
+    TinyPtrConfig c;
+    tiny_ptr_default_config(capacity, variant, 0.9, &c);
+    switch (variant) {
+        case TINY_PTR_SIMPLE:
+            for (size_t b = 0; b < COUNT_OF(tune_bucket_sizes); b++) {
+                for (size_t l = 0; l < COUNT_OF(tune_load_factors); l++) {
+                    c.bucket_size = tune_bucket_sizes[b];
+                    c.load_factor = tune_load_factors[l];
+                    try_candidate(t, &c);
+                }
+            }
+            break;
+        case TINY_PTR_FIXED:
+            for (size_t f = 0; f < COUNT_OF(tune_primary_fractions); f++) {
+                for (size_t l = 0; l < COUNT_OF(tune_load_factors); l++) {
+                    c.primary_fraction = tune_primary_fractions[f];
+                    c.load_factor = tune_load_factors[l];
+                    try_candidate(t, &c);
+                }
+            }
+            break;
+        case TINY_PTR_VARIABLE:
+            for (size_t k = 0; k < COUNT_OF(tune_container_counts); k++) {
+                for (size_t l = 0; l < COUNT_OF(tune_level_counts); l++) {
+                    c.container_capacity = (capacity + tune_container_counts[k] - 1) / tune_container_counts[k];
+                    c.level_count = tune_level_counts[l];
+                    try_candidate(t, &c);
+                }
+            }
+            break;
+        case TINY_PTR_SHARDED:
+            /* Record the count measured here, so the result builds the same layout on any host */
+            c.shard_count = sharded_default_shard_count();
+            for (size_t l = 0; l < COUNT_OF(tune_load_factors); l++) {
+                c.load_factor = tune_load_factors[l];
+                try_candidate(t, &c);
+            }
+            break;
+    }
+}
+
+int tiny_ptr_tune_workload(TinyPtrVariant variant, const TinyPtrOp *ops, size_t n,
+                           double target_failure, TinyPtrConfig *config, TinyPtrTuneReport *report) {
+    if (!ops || n == 0 || !config || target_failure < 0) return -1;
+    if (variant != TINY_PTR_SIMPLE && variant != TINY_PTR_FIXED &&
+        variant != TINY_PTR_VARIABLE && variant != TINY_PTR_SHARDED) return -1;
+    Tuner t = {0};
+    size_t *pair = malloc(n * sizeof(size_t));
+    t.tps = malloc(n * sizeof(int));
+    size_t peak = (pair && t.tps) ? pair_workload(ops, n, pair) : 0;
+    if (peak > 0) {
+        t.ops = ops;
+        t.n = n;
+        t.pair = pair;
+        for (size_t i = 0; i < n; i++)
+            if (!ops[i].is_free) t.allocations++;
+        t.allowed_failures = (size_t)(target_failure * (double)t.allocations);
+        tune_candidates(&t, variant, peak);
+    }
+    free(pair);
+    free(t.tps);
+    if (!t.found) return -1;
+    *config = t.best;
+    if (report) {
+        *report = t.report;
+        report->allocations = t.allocations;
+    }
+    return 0;
+}
+
+int tiny_ptr_tune(TinyPtrVariant variant, const int *keys, size_t n, double target_failure,
+                  TinyPtrConfig *config, TinyPtrTuneReport *report) {
+    if (!keys || n == 0) return -1;
+    TinyPtrOp *ops = malloc(n * sizeof(TinyPtrOp));
+    if (!ops) return -1;
+    for (size_t i = 0; i < n; i++) {
+        ops[i].key = keys[i];
+        ops[i].is_free = 0;
+    }
+    int rc = tiny_ptr_tune_workload(variant, ops, n, target_failure, config, report);
+    free(ops);
+    return rc;
+}
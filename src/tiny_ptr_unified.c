@@ -1,108 +1,466 @@
-#include "tiny_ptr_unified.h"
-#include "tiny_ptr_simple.h"
-#include "tiny_ptr_fixed.h"
-#include "tiny_ptr_variable.h"
-#include <stdlib.h>
-
-tiny_ptr_table_t* tiny_ptr_create(size_t capacity, TinyPtrVariant variant, double load_factor) {
-    tiny_ptr_table_t* ut = malloc(sizeof(tiny_ptr_table_t));
-    if (!ut) return NULL;
-    ut->variant = variant;
-    switch (variant) {
-        case TINY_PTR_SIMPLE:
-            /* For the simple variant, use our extended create function */
-            ut->table = simple_create_ex(capacity, load_factor);
-            break;
-        case TINY_PTR_FIXED:
-            ut->table = fixed_create(capacity, load_factor);
-            break;
-        case TINY_PTR_VARIABLE: {
-            size_t container_capacity = capacity / 4;
-            if (container_capacity == 0) container_capacity = 1;
-            size_t level_count = 4;  // default level count
-            ut->table = variable_create(capacity, container_capacity, level_count);
-            break;
-        }
-        default:
-            free(ut);
-            return NULL;
-    }
-    if (!ut->table) {
-        free(ut);
-        return NULL;
-    }
-    return ut;
-}
-
-int tiny_ptr_allocate(tiny_ptr_table_t* ut, int key, int value) {
-    if (!ut) return -1;
-    switch (ut->variant) {
-        case TINY_PTR_SIMPLE:
-            return simple_allocate((SimpleTable*) ut->table, key, value);
-        case TINY_PTR_FIXED:
-            return fixed_allocate((struct FixedTable*) ut->table, key, value);
-        case TINY_PTR_VARIABLE:
-            return variable_allocate((struct VariableTable*) ut->table, key, value);
-        default:
-            return -1;
-    }
-}
-
-int tiny_ptr_dereference(tiny_ptr_table_t* ut, int key, int tiny_ptr) {
-    if (!ut) return -1;
-    switch (ut->variant) {
-        case TINY_PTR_SIMPLE:
-            return simple_dereference((SimpleTable*) ut->table, key, tiny_ptr);
-        case TINY_PTR_FIXED:
-            return fixed_dereference((struct FixedTable*) ut->table, key, tiny_ptr);
-        case TINY_PTR_VARIABLE:
-            return variable_dereference((struct VariableTable*) ut->table, key, tiny_ptr);
-        default:
-            return -1;
-    }
-}
-
-void tiny_ptr_free(tiny_ptr_table_t* ut, int key, int tiny_ptr) {
-    if (!ut) return;
-    switch (ut->variant) {
-        case TINY_PTR_SIMPLE:
-            simple_free((SimpleTable*) ut->table, key, tiny_ptr);
-            break;
-        case TINY_PTR_FIXED:
-            fixed_free((struct FixedTable*) ut->table, key, tiny_ptr);
-            break;
-        case TINY_PTR_VARIABLE:
-            variable_free((struct VariableTable*) ut->table, key, tiny_ptr);
-            break;
-    }
-}
-
-/* Only the simple variant supports resizing. */
-int tiny_ptr_resize(tiny_ptr_table_t** ut_ptr, size_t new_capacity) {
-    if (!ut_ptr || !(*ut_ptr)) return -1;
-    tiny_ptr_table_t* ut = *ut_ptr;
-    if (ut->variant != TINY_PTR_SIMPLE)
-        return -1; // Resizing is not supported for fixed or variable variants.
-    SimpleTable* st = (SimpleTable*) ut->table;
-    SimpleTable* new_st = simple_resize(st, new_capacity);
-    if (!new_st)
-        return -1;
-    ut->table = new_st;
-    return 0;
-}
-
-void tiny_ptr_destroy(tiny_ptr_table_t* ut) {
-    if (!ut) return;
-    switch (ut->variant) {
-        case TINY_PTR_SIMPLE:
-            simple_destroy((SimpleTable*) ut->table);
-            break;
-        case TINY_PTR_FIXED:
-            fixed_destroy((struct FixedTable*) ut->table);
-            break;
-        case TINY_PTR_VARIABLE:
-            variable_destroy((struct VariableTable*) ut->table);
-            break;
-    }
-    free(ut);
-}
+#include "tiny_ptr_unified.h"
+#include "tiny_ptr_simple.h"
+#include "tiny_ptr_fixed.h"
+#include "tiny_ptr_variable.h"
+#include "tiny_ptr_sharded.h"
+#include <stdlib.h>
+
+/* Number of successively larger configurations tiny_ptr_bulk_build tries */
+#define TINY_PTR_BULK_BUILD_ATTEMPTS 16
+
+/*
+ * Concurrency model: dereferences never take a table-wide lock. They enter
+ * the epoch domain and load ut->table once; a resize publishes the new
+ * table atomically and frees the old one only after epoch_synchronize, so
+ * a reader can never see freed memory. Allocate/free hold resize_lock in
+ * shared mode so they cannot write into a table that is being retired.
+ */
+
+static inline void* current_table(tiny_ptr_table_t* ut) {
+    return __atomic_load_n(&ut->table, __ATOMIC_SEQ_CST);
+}
+
+static void destroy_variant_table(TinyPtrVariant variant, void* table) {
+    switch (variant) {
+        case TINY_PTR_SIMPLE:
+            simple_destroy((SimpleTable*) table);
+            break;
+        case TINY_PTR_FIXED:
+            fixed_destroy((struct FixedTable*) table);
+            break;
+        case TINY_PTR_VARIABLE:
+            variable_destroy((struct VariableTable*) table);
+            break;
+        case TINY_PTR_SHARDED:
+            sharded_destroy((ShardedTable*) table);
+            break;
+    }
+}
+
+int tiny_ptr_default_config(size_t capacity, TinyPtrVariant variant, double load_factor,
+                            TinyPtrConfig* config) {
+    if (!config) return -1;
+    config->variant = variant;
+    config->capacity = capacity;
+    config->load_factor = load_factor;
+    config->bucket_size = 0;
+    config->primary_fraction = TINY_PTR_DEFAULT_PRIMARY_FRACTION;
+    config->container_capacity = capacity / TINY_PTR_DEFAULT_CONTAINERS;
+    if (config->container_capacity == 0) config->container_capacity = 1;
+    config->level_count = TINY_PTR_DEFAULT_LEVELS;
+    config->shard_count = 0;
+    return 0;
+}
+
+tiny_ptr_table_t* tiny_ptr_create_config(const TinyPtrConfig* config) {
+    if (!config) return NULL;
+    tiny_ptr_table_t* ut = malloc(sizeof(tiny_ptr_table_t));
+    if (!ut) return NULL;
+    ut->variant = config->variant;
+    switch (config->variant) {
+        case TINY_PTR_SIMPLE:
+            ut->table = simple_create_sized(config->capacity, config->load_factor, config->bucket_size);
+            break;
+        case TINY_PTR_FIXED:
+            ut->table = fixed_create_ex(config->capacity, config->load_factor, config->primary_fraction);
+            break;
+        case TINY_PTR_VARIABLE:
+            /* The tiny pointer has 4 level bits */
+            ut->table = (config->container_capacity == 0 || config->level_count == 0 ||
+                         config->level_count > 16) ? NULL :
+                variable_create(config->capacity, config->container_capacity, config->level_count);
+            break;
+        case TINY_PTR_SHARDED:
+            ut->table = sharded_create(config->capacity, config->shard_count, config->load_factor);
+            break;
+        default:
+            free(ut);
+            return NULL;
+    }
+    if (!ut->table) {
+        free(ut);
+        return NULL;
+    }
+    ut->epoch = epoch_create();
+    if (!ut->epoch) {
+        destroy_variant_table(config->variant, ut->table);
+        free(ut);
+        return NULL;
+    }
+    pthread_rwlock_init(&ut->resize_lock, NULL);
+    ut->open_cursors = 0;
+    return ut;
+}
+
+tiny_ptr_table_t* tiny_ptr_create(size_t capacity, TinyPtrVariant variant, double load_factor) {
+    TinyPtrConfig config;
+    tiny_ptr_default_config(capacity, variant, load_factor, &config);
+    return tiny_ptr_create_config(&config);
+}
+
+/* Wraps a shared SimpleTable; the wrapper itself is private to this process. */
+static tiny_ptr_table_t* wrap_shared(SimpleTable* st) {
+    if (!st) return NULL;
+    tiny_ptr_table_t* ut = malloc(sizeof(tiny_ptr_table_t));
+    if (ut) ut->epoch = epoch_create();
+    if (!ut || !ut->epoch) {
+        free(ut);
+        simple_destroy(st);
+        return NULL;
+    }
+    ut->variant = TINY_PTR_SIMPLE;
+    ut->table = st;
+    pthread_rwlock_init(&ut->resize_lock, NULL);
+    ut->open_cursors = 0;
+    return ut;
+}
+
+/*
+ * Shared tables use the SIMPLE variant only: its state is three flat arrays
+ * and one lock, which map directly onto a shared region. The other variants
+ * are trees of separately allocated tables.
+ */
+tiny_ptr_table_t* tiny_ptr_create_shared(const char* name, size_t capacity, double load_factor) {
+    return wrap_shared(simple_create_shared(name, capacity, load_factor));
+}
+
+tiny_ptr_table_t* tiny_ptr_attach_shared(const char* name) {
+    return wrap_shared(simple_attach_shared(name));
+}
+
+tiny_ptr_table_t* tiny_ptr_attach_shared_fd(int fd) {
+    return wrap_shared(simple_attach_shared_fd(fd));
+}
+
+int tiny_ptr_allocate(tiny_ptr_table_t* ut, int key, int value) {
+    if (!ut) return -1;
+    if (ut->variant == TINY_PTR_SHARDED)
+        return sharded_allocate((ShardedTable*) ut->table, key, value);
+    int ret;
+    pthread_rwlock_rdlock(&ut->resize_lock);
+    switch (ut->variant) {
+        case TINY_PTR_SIMPLE:
+            ret = simple_allocate((SimpleTable*) ut->table, key, value);
+            break;
+        case TINY_PTR_FIXED:
+            ret = fixed_allocate((struct FixedTable*) ut->table, key, value);
+            break;
+        case TINY_PTR_VARIABLE:
+            ret = variable_allocate((struct VariableTable*) ut->table, key, value);
+            break;
+        default:
+            ret = -1;
+    }
+    pthread_rwlock_unlock(&ut->resize_lock);
+    return ret;
+}
+
+int tiny_ptr_dereference(tiny_ptr_table_t* ut, int key, int tiny_ptr) {
+    if (!ut) return -1;
+    if (ut->variant == TINY_PTR_SHARDED)
+        return sharded_dereference((ShardedTable*) ut->table, key, tiny_ptr);
+    int ret;
+    int ticket = epoch_enter(ut->epoch);
+    void* table = current_table(ut);
+    switch (ut->variant) {
+        case TINY_PTR_SIMPLE:
+            ret = simple_dereference_unlocked((SimpleTable*) table, key, tiny_ptr);
+            break;
+        case TINY_PTR_FIXED:
+            ret = fixed_dereference((struct FixedTable*) table, key, tiny_ptr);
+            break;
+        case TINY_PTR_VARIABLE:
+            ret = variable_dereference((struct VariableTable*) table, key, tiny_ptr);
+            break;
+        default:
+            ret = -1;
+    }
+    epoch_exit(ut->epoch, ticket);
+    return ret;
+}
+
+/*
+ * tiny_ptr_find recovers the tiny pointers of key by scanning its bucket(s):
+ * primary before secondary for FIXED, level by level for VARIABLE. Like a
+ * dereference it pins the current table and never blocks on a resize.
+ */
+size_t tiny_ptr_find(tiny_ptr_table_t* ut, int key, int* out_tiny_ptrs, size_t max) {
+    if (!ut || (max > 0 && !out_tiny_ptrs)) return 0;
+    if (ut->variant == TINY_PTR_SHARDED)
+        return sharded_find((ShardedTable*) ut->table, key, out_tiny_ptrs, max);
+    size_t found;
+    int ticket = epoch_enter(ut->epoch);
+    void* table = current_table(ut);
+    switch (ut->variant) {
+        case TINY_PTR_SIMPLE:
+            found = simple_find_unlocked((SimpleTable*) table, key, out_tiny_ptrs, max);
+            break;
+        case TINY_PTR_FIXED:
+            found = fixed_find((struct FixedTable*) table, key, out_tiny_ptrs, max);
+            break;
+        case TINY_PTR_VARIABLE:
+            found = variable_find((struct VariableTable*) table, key, out_tiny_ptrs, max);
+            break;
+        default:
+            found = 0;
+    }
+    epoch_exit(ut->epoch, ticket);
+    return found;
+}
+
+/*
+ * The SIMPLE variant runs the whole batch lock-free under one epoch, with
+ * the keys hashed by the dispatched kernel; the other variants dereference
+ * pair by pair.
+ */
+int tiny_ptr_dereference_batch(tiny_ptr_table_t* ut, const int* keys, const int* tiny_ptrs,
+                               size_t n, int* out) {
+    if (!ut || (n > 0 && (!keys || !tiny_ptrs || !out))) return -1;
+    if (ut->variant != TINY_PTR_SIMPLE) {
+        for (size_t i = 0; i < n; i++)
+            out[i] = tiny_ptr_dereference(ut, keys[i], tiny_ptrs[i]);
+        return 0;
+    }
+    int ticket = epoch_enter(ut->epoch);
+    int ret = simple_dereference_batch_unlocked((SimpleTable*) current_table(ut), keys, tiny_ptrs, n, out);
+    epoch_exit(ut->epoch, ticket);
+    return ret;
+}
+
+void tiny_ptr_free(tiny_ptr_table_t* ut, int key, int tiny_ptr) {
+    if (!ut) return;
+    if (ut->variant == TINY_PTR_SHARDED) {
+        sharded_free((ShardedTable*) ut->table, key, tiny_ptr);
+        return;
+    }
+    pthread_rwlock_rdlock(&ut->resize_lock);
+    switch (ut->variant) {
+        case TINY_PTR_SIMPLE:
+            simple_free((SimpleTable*) ut->table, key, tiny_ptr);
+            break;
+        case TINY_PTR_FIXED:
+            fixed_free((struct FixedTable*) ut->table, key, tiny_ptr);
+            break;
+        case TINY_PTR_VARIABLE:
+            variable_free((struct VariableTable*) ut->table, key, tiny_ptr);
+            break;
+        default:
+            break;
+    }
+    pthread_rwlock_unlock(&ut->resize_lock);
+}
+
+/*
+ * Opening a cursor counts it under resize_lock, and resize/compact check
+ * the count under the exclusive lock, so the table a cursor walks is never
+ * retired while it is open. No lock is held between calls. Sharded tables
+ * count cursors per shard inside the sharded cursor instead.
+ */
+int tiny_ptr_cursor_open(tiny_ptr_table_t* ut, TinyPtrCursor* cur, size_t part, size_t parts) {
+    if (!ut || !cur || parts == 0 || part >= parts) return -1;
+    cur->table = ut;
+    if (ut->variant == TINY_PTR_SHARDED) {
+        sharded_cursor_init((ShardedTable*) ut->table, &cur->u.sharded, part, parts);
+        return 0;
+    }
+    pthread_rwlock_rdlock(&ut->resize_lock);
+    __atomic_add_fetch(&ut->open_cursors, 1, __ATOMIC_RELAXED);
+    switch (ut->variant) {
+        case TINY_PTR_SIMPLE:
+            simple_cursor_part((SimpleTable*) ut->table, &cur->u.simple, part, parts);
+            break;
+        case TINY_PTR_FIXED:
+            fixed_cursor_init((struct FixedTable*) ut->table, &cur->u.fixed, part, parts);
+            break;
+        case TINY_PTR_VARIABLE:
+            variable_cursor_init((struct VariableTable*) ut->table, &cur->u.variable, part, parts);
+            break;
+        default:
+            break;
+    }
+    pthread_rwlock_unlock(&ut->resize_lock);
+    return 0;
+}
+
+int tiny_ptr_cursor_next(TinyPtrCursor* cur, int* key, int* value, int* tiny_ptr) {
+    if (!cur || !cur->table) return 0;
+    tiny_ptr_table_t* ut = cur->table;
+    switch (ut->variant) {
+        case TINY_PTR_SIMPLE:
+            return simple_cursor_next((SimpleTable*) ut->table, &cur->u.simple, key, value, tiny_ptr);
+        case TINY_PTR_FIXED:
+            return fixed_cursor_next((struct FixedTable*) ut->table, &cur->u.fixed, key, value, tiny_ptr);
+        case TINY_PTR_VARIABLE:
+            return variable_cursor_next((struct VariableTable*) ut->table, &cur->u.variable, key, value, tiny_ptr);
+        case TINY_PTR_SHARDED:
+            return sharded_cursor_next((ShardedTable*) ut->table, &cur->u.sharded, key, value, tiny_ptr);
+    }
+    return 0;
+}
+
+void tiny_ptr_cursor_close(TinyPtrCursor* cur) {
+    if (!cur || !cur->table) return;
+    tiny_ptr_table_t* ut = cur->table;
+    if (ut->variant == TINY_PTR_SHARDED)
+        sharded_cursor_close((ShardedTable*) ut->table, &cur->u.sharded);
+    else
+        __atomic_sub_fetch(&ut->open_cursors, 1, __ATOMIC_RELEASE);
+    cur->table = NULL;
+}
+
+/*
+ * Only the simple and sharded variants support resizing. Readers keep using
+ * the old table while it is rehashed; it is destroyed once no reader can
+ * hold it. A sharded table resizes shard by shard. Resizing fails while a
+ * cursor is open.
+ */
+int tiny_ptr_resize(tiny_ptr_table_t** ut_ptr, size_t new_capacity) {
+    return tiny_ptr_resize_parallel(ut_ptr, new_capacity, 1);
+}
+
+/* Resize with the rehash split across nthreads worker threads. */
+int tiny_ptr_resize_parallel(tiny_ptr_table_t** ut_ptr, size_t new_capacity, int nthreads) {
+    if (!ut_ptr || !(*ut_ptr)) return -1;
+    tiny_ptr_table_t* ut = *ut_ptr;
+    if (ut->variant == TINY_PTR_SHARDED)
+        return sharded_resize((ShardedTable*) ut->table, new_capacity, nthreads);
+    if (ut->variant != TINY_PTR_SIMPLE)
+        return -1; // Resizing is not supported for fixed or variable variants.
+    if (simple_is_shared((SimpleTable*) ut->table))
+        return -1; // Other processes map the shared region in place.
+    pthread_rwlock_wrlock(&ut->resize_lock);
+    if (__atomic_load_n(&ut->open_cursors, __ATOMIC_ACQUIRE) > 0) {
+        pthread_rwlock_unlock(&ut->resize_lock);
+        return -1; // A cursor is walking the current table.
+    }
+    SimpleTable* st = (SimpleTable*) ut->table;
+    SimpleTable* new_st = simple_rehash_parallel(st, new_capacity, nthreads);
+    if (!new_st) {
+        pthread_rwlock_unlock(&ut->resize_lock);
+        return -1;
+    }
+    __atomic_store_n(&ut->table, new_st, __ATOMIC_SEQ_CST);
+    pthread_rwlock_unlock(&ut->resize_lock);
+    epoch_synchronize(ut->epoch);
+    simple_destroy(st);
+    return 0;
+}
+
+/*
+ * tiny_ptr_compact shrinks the table to the smallest configuration that
+ * holds its live entries (or leaves it as is if none is smaller) and calls
+ * remap for every entry whose tiny pointer changed. Reported tiny pointers
+ * are valid once the call returns. remap runs while allocate/free are
+ * held off, so it must not call back into the table. Compaction fails
+ * while a cursor is open.
+ */
+int tiny_ptr_compact(tiny_ptr_table_t* ut, tiny_ptr_remap_fn remap, void* ctx) {
+    if (!ut) return -1;
+    if (ut->variant == TINY_PTR_SHARDED)
+        return sharded_compact((ShardedTable*) ut->table, remap, ctx);
+    if (ut->variant == TINY_PTR_SIMPLE && simple_is_shared((SimpleTable*) ut->table))
+        return -1;
+    pthread_rwlock_wrlock(&ut->resize_lock);
+    if (__atomic_load_n(&ut->open_cursors, __ATOMIC_ACQUIRE) > 0) {
+        pthread_rwlock_unlock(&ut->resize_lock);
+        return -1;
+    }
+    void* old_table = ut->table;
+    void* new_table;
+    switch (ut->variant) {
+        case TINY_PTR_SIMPLE:
+            new_table = simple_compact((SimpleTable*) old_table, remap, ctx);
+            break;
+        case TINY_PTR_FIXED:
+            new_table = fixed_compact((struct FixedTable*) old_table, remap, ctx);
+            break;
+        case TINY_PTR_VARIABLE:
+            new_table = variable_compact((struct VariableTable*) old_table, remap, ctx);
+            break;
+        default:
+            new_table = NULL;
+    }
+    if (!new_table) {
+        /* Nothing smaller fits: keep the current table */
+        pthread_rwlock_unlock(&ut->resize_lock);
+        return 0;
+    }
+    __atomic_store_n(&ut->table, new_table, __ATOMIC_SEQ_CST);
+    pthread_rwlock_unlock(&ut->resize_lock);
+    epoch_synchronize(ut->epoch);
+    destroy_variant_table(ut->variant, old_table);
+    return 0;
+}
+
+/*
+ * tiny_ptr_bulk_build starts from a table sized for exactly n entries at a
+ * load factor of 1.0 and grows it by 25% per attempt until a bulk load
+ * places every pair. The first configuration without overflow is kept.
+ */
+tiny_ptr_table_t* tiny_ptr_bulk_build(TinyPtrVariant variant, const int* keys, const int* values,
+                                      size_t n, int* out_tiny_ptrs, int nthreads) {
+    if (n == 0 || !keys || !values || !out_tiny_ptrs) return NULL;
+    size_t capacity = n;
+    for (int attempt = 0; attempt < TINY_PTR_BULK_BUILD_ATTEMPTS; attempt++) {
+        tiny_ptr_table_t* ut = tiny_ptr_create(capacity, variant, 1.0);
+        if (!ut) return NULL;
+        size_t placed;
+        switch (variant) {
+            case TINY_PTR_SIMPLE:
+                placed = simple_bulk_load((SimpleTable*) ut->table, keys, values, n, out_tiny_ptrs, nthreads);
+                break;
+            case TINY_PTR_FIXED:
+                placed = fixed_bulk_load((struct FixedTable*) ut->table, keys, values, n, out_tiny_ptrs, nthreads);
+                break;
+            case TINY_PTR_VARIABLE:
+                placed = variable_bulk_load((struct VariableTable*) ut->table, keys, values, n, out_tiny_ptrs, nthreads);
+                break;
+            case TINY_PTR_SHARDED:
+                placed = sharded_bulk_load((ShardedTable*) ut->table, keys, values, n, out_tiny_ptrs, nthreads);
+                break;
+            default:
+                placed = 0;
+        }
+        if (placed == n)
+            return ut;
+        tiny_ptr_destroy(ut);
+        capacity += capacity / 4 + 1;
+    }
+    return NULL;
+}
+
+size_t tiny_ptr_memory_usage(tiny_ptr_table_t* ut) {
+    if (!ut) return 0;
+    if (ut->variant == TINY_PTR_SHARDED)
+        return sizeof(tiny_ptr_table_t) + sharded_memory_usage((ShardedTable*) ut->table);
+    int ticket = epoch_enter(ut->epoch);
+    void* table = current_table(ut);
+    size_t bytes = sizeof(tiny_ptr_table_t);
+    switch (ut->variant) {
+        case TINY_PTR_SIMPLE:
+            bytes += simple_memory_usage((SimpleTable*) table);
+            break;
+        case TINY_PTR_FIXED:
+            bytes += fixed_memory_usage((struct FixedTable*) table);
+            break;
+        case TINY_PTR_VARIABLE:
+            bytes += variable_memory_usage((struct VariableTable*) table);
+            break;
+        default:
+            break;
+    }
+    epoch_exit(ut->epoch, ticket);
+    return bytes;
+}
+
+TinyPtrSimdLevel tiny_ptr_simd_level(void) {
+    return simple_simd_level();
+}
+
+void tiny_ptr_destroy(tiny_ptr_table_t* ut) {
+    if (!ut) return;
+    destroy_variant_table(ut->variant, ut->table);
+    pthread_rwlock_destroy(&ut->resize_lock);
+    epoch_destroy(ut->epoch);
+    free(ut);
+}
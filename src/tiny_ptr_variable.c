@@ -1,134 +1,542 @@
-#include "tiny_ptr_variable.h"
-#include "tiny_ptr_simple.h"
-#include <stdlib.h>
-#include <stdio.h>
-#include <pthread.h>
-#include <stdint.h>
-
-typedef struct {
-    size_t level_count;
-    SimpleTable **levels;
-} Container;
-
-static Container* container_create(size_t container_capacity, size_t level_count) {
-    Container *c = malloc(sizeof(Container));
-    if (!c) return NULL;
-    c->level_count = level_count;
-    c->levels = malloc(level_count * sizeof(SimpleTable*));
-    if (!c->levels) { free(c); return NULL; }
-    size_t level_capacity = container_capacity / level_count;
-    if (level_capacity == 0) level_capacity = 1;
-    for (size_t i = 0; i < level_count; i++) {
-        c->levels[i] = simple_create(level_capacity);
-        if (!c->levels[i]) {
-            for (size_t j = 0; j < i; j++)
-                simple_destroy(c->levels[j]);
-            free(c->levels);
-            free(c);
-            return NULL;
-        }
-    }
-    return c;
-}
-
-/* Revised container_destroy: do not free the container itself if it was copied into an array */
-static void container_destroy(Container *c) {
-    if (!c) return;
-    for (size_t i = 0; i < c->level_count; i++) {
-        simple_destroy(c->levels[i]);
-    }
-    free(c->levels);
-    /* Do not free(c) since the container struct is stored in an external array */
-}
-
-struct VariableTable {
-    size_t container_count;
-    Container *containers;   /* Array of Container structs */
-    pthread_mutex_t mutex;
-};
-
-VariableTable* variable_create(size_t total_capacity, size_t container_capacity, size_t level_count) {
-    VariableTable *vt = malloc(sizeof(VariableTable));
-    if (!vt) return NULL;
-    vt->container_count = (total_capacity + container_capacity - 1) / container_capacity;
-    vt->containers = malloc(vt->container_count * sizeof(Container));
-    if (!vt->containers) { free(vt); return NULL; }
-    for (size_t i = 0; i < vt->container_count; i++) {
-        Container *c = container_create(container_capacity, level_count);
-        if (!c) {
-            for (size_t j = 0; j < i; j++)
-                container_destroy(&vt->containers[j]);
-            free(vt->containers);
-            free(vt);
-            return NULL;
-        }
-        vt->containers[i] = *c;  // Copy container structure into array.
-        free(c);  // Free the temporary allocation.
-    }
-    pthread_mutex_init(&vt->mutex, NULL);
-    return vt;
-}
-
-void variable_destroy(VariableTable *vt) {
-    if (!vt) return;
-    pthread_mutex_destroy(&vt->mutex);
-    for (size_t i = 0; i < vt->container_count; i++) {
-        container_destroy(&vt->containers[i]);
-    }
-    free(vt->containers);
-    free(vt);
-}
-
-int variable_allocate(VariableTable *vt, int key, int value) {
-    if (!vt) return -1;
-    pthread_mutex_lock(&vt->mutex);
-    uint32_t h = 0;
-    {   /* Simple hash for int keys */
-        uint32_t k = (uint32_t) key;
-        k ^= k >> 16;
-        k *= 0x85ebca6b;
-        k ^= k >> 13;
-        k *= 0xc2b2ae35;
-        k ^= k >> 16;
-        h = k;
-    }
-    int container_index = h % vt->container_count;
-    Container *c = &vt->containers[container_index];
-    int tp = -1, level_found = -1;
-    for (size_t level = 0; level < c->level_count; level++) {
-        tp = simple_allocate(c->levels[level], key, value);
-        if (tp != -1) {
-            level_found = (int)level;
-            break;
-        }
-    }
-    int tiny_ptr = -1;
-    if (tp != -1 && level_found != -1) {
-        tiny_ptr = ((container_index & 0xFF) << 8) | ((level_found & 0xF) << 4) | (tp & 0xF);
-    }
-    pthread_mutex_unlock(&vt->mutex);
-    return tiny_ptr;
-}
-
-int variable_dereference(VariableTable *vt, int key, int tiny_ptr) {
-    if (!vt) return -1;
-    uint32_t container_index = (tiny_ptr >> 8) & 0xFF;
-    uint32_t level = (tiny_ptr >> 4) & 0xF;
-    uint32_t tp = tiny_ptr & 0xF;
-    pthread_mutex_lock(&vt->mutex);
-    Container *c = &vt->containers[container_index];
-    int ret = simple_dereference(c->levels[level], key, tp);
-    pthread_mutex_unlock(&vt->mutex);
-    return ret;
-}
-
-void variable_free(VariableTable *vt, int key, int tiny_ptr) {
-    if (!vt) return;
-    uint32_t container_index = (tiny_ptr >> 8) & 0xFF;
-    uint32_t level = (tiny_ptr >> 4) & 0xF;
-    uint32_t tp = tiny_ptr & 0xF;
-    pthread_mutex_lock(&vt->mutex);
-    Container *c = &vt->containers[container_index];
-    simple_free(c->levels[level], key, tp);
-    pthread_mutex_unlock(&vt->mutex);
-}
+#include "tiny_ptr_variable.h"
+#include "tiny_ptr_simple.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#define VARIABLE_CACHE_LINE 64
+
+/*
+ * Containers are the unit of concurrency: every operation touches exactly
+ * one container and holds only its lock, calling the unlocked SimpleTable
+ * primitives on the levels. Containers are padded to whole cache lines so
+ * neighbouring locks do not share a line.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    size_t level_count;
+    SimpleTable **levels;
+} __attribute__((aligned(VARIABLE_CACHE_LINE))) Container;
+
+static int container_init(Container *c, size_t container_capacity, size_t level_count) {
+    c->level_count = level_count;
+    c->levels = malloc(level_count * sizeof(SimpleTable*));
+    if (!c->levels) return -1;
+    size_t level_capacity = container_capacity / level_count;
+    if (level_capacity == 0) level_capacity = 1;
+    for (size_t i = 0; i < level_count; i++) {
+        c->levels[i] = simple_create(level_capacity);
+        if (!c->levels[i]) {
+            for (size_t j = 0; j < i; j++)
+                simple_destroy(c->levels[j]);
+            free(c->levels);
+            return -1;
+        }
+    }
+    pthread_mutex_init(&c->lock, NULL);
+    return 0;
+}
+
+/* Releases the levels; the Container itself lives in the table's array */
+static void container_destroy(Container *c) {
+    if (!c) return;
+    pthread_mutex_destroy(&c->lock);
+    for (size_t i = 0; i < c->level_count; i++) {
+        simple_destroy(c->levels[i]);
+    }
+    free(c->levels);
+}
+
+struct VariableTable {
+    size_t total_capacity;
+    size_t container_capacity;
+    size_t level_count;
+    size_t container_count;
+    Container *containers;   /* Array of Container structs, each with its own lock */
+};
+
+/* Simple hash for int keys, used to pick a container */
+static inline uint32_t variable_hash(int key) {
+    uint32_t k = (uint32_t) key;
+    k ^= k >> 16;
+    k *= 0x85ebca6b;
+    k ^= k >> 13;
+    k *= 0xc2b2ae35;
+    k ^= k >> 16;
+    return k;
+}
+
+/* Multiply-shift range reduction: maps the 32-bit hash onto [0, container_count) without a divide */
+static inline int container_of(const VariableTable *vt, int key) {
+    return (int)(((uint64_t)variable_hash(key) * vt->container_count) >> 32);
+}
+
+/*
+ * Tiny pointer layout: | container (8 bits) | level (4 bits) | slot (6 bits) |
+ * The slot field covers buckets of up to 64 slots.
+ */
+#define VARIABLE_SLOT_BITS 6
+#define VARIABLE_LEVEL_BITS 4
+
+static inline int encode_tiny_ptr(int container_index, int level, int tp) {
+    return ((container_index & 0xFF) << (VARIABLE_SLOT_BITS + VARIABLE_LEVEL_BITS))
+         | ((level & 0xF) << VARIABLE_SLOT_BITS)
+         | (tp & 0x3F);
+}
+
+VariableTable* variable_create(size_t total_capacity, size_t container_capacity, size_t level_count) {
+    VariableTable *vt = malloc(sizeof(VariableTable));
+    if (!vt) return NULL;
+    vt->total_capacity = total_capacity;
+    vt->container_capacity = container_capacity;
+    vt->level_count = level_count;
+    vt->container_count = (total_capacity + container_capacity - 1) / container_capacity;
+    if (posix_memalign((void **)&vt->containers, VARIABLE_CACHE_LINE, vt->container_count * sizeof(Container)) != 0) {
+        free(vt);
+        return NULL;
+    }
+    for (size_t i = 0; i < vt->container_count; i++) {
+        if (container_init(&vt->containers[i], container_capacity, level_count) != 0) {
+            for (size_t j = 0; j < i; j++)
+                container_destroy(&vt->containers[j]);
+            free(vt->containers);
+            free(vt);
+            return NULL;
+        }
+    }
+    return vt;
+}
+
+void variable_destroy(VariableTable *vt) {
+    if (!vt) return;
+    for (size_t i = 0; i < vt->container_count; i++) {
+        container_destroy(&vt->containers[i]);
+    }
+    free(vt->containers);
+    free(vt);
+}
+
+int variable_allocate(VariableTable *vt, int key, int value) {
+    if (!vt) return -1;
+    int container_index = container_of(vt, key);
+    Container *c = &vt->containers[container_index];
+    int tiny_ptr = -1;
+    pthread_mutex_lock(&c->lock);
+    for (size_t level = 0; level < c->level_count; level++) {
+        int tp = simple_allocate_unlocked(c->levels[level], key, value);
+        if (tp != -1) {
+            tiny_ptr = encode_tiny_ptr(container_index, (int)level, tp);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return tiny_ptr;
+}
+
+/*
+ * Takes no lock: a container's levels are fixed at creation and the slot is
+ * read with a single atomic load, so readers never wait on writers.
+ */
+int variable_dereference(VariableTable *vt, int key, int tiny_ptr) {
+    if (!vt) return -1;
+    uint32_t container_index = (tiny_ptr >> (VARIABLE_SLOT_BITS + VARIABLE_LEVEL_BITS)) & 0xFF;
+    uint32_t level = (tiny_ptr >> VARIABLE_SLOT_BITS) & 0xF;
+    uint32_t tp = tiny_ptr & 0x3F;
+    Container *c = &vt->containers[container_index];
+    return simple_dereference_unlocked(c->levels[level], key, tp);
+}
+
+void variable_free(VariableTable *vt, int key, int tiny_ptr) {
+    if (!vt) return;
+    uint32_t container_index = (tiny_ptr >> (VARIABLE_SLOT_BITS + VARIABLE_LEVEL_BITS)) & 0xFF;
+    uint32_t level = (tiny_ptr >> VARIABLE_SLOT_BITS) & 0xF;
+    uint32_t tp = tiny_ptr & 0x3F;
+    Container *c = &vt->containers[container_index];
+    pthread_mutex_lock(&c->lock);
+    simple_free_unlocked(c->levels[level], key, tp);
+    pthread_mutex_unlock(&c->lock);
+}
+
+/* Searches the levels of key's container in order under the container lock */
+size_t variable_find(VariableTable *vt, int key, int *out_tiny_ptrs, size_t max) {
+    if (!vt || (max > 0 && !out_tiny_ptrs)) return 0;
+    int container_index = container_of(vt, key);
+    Container *c = &vt->containers[container_index];
+    size_t found = 0;
+    pthread_mutex_lock(&c->lock);
+    for (size_t level = 0; level < c->level_count && found < max; level++) {
+        size_t n = simple_find_unlocked(c->levels[level], key, out_tiny_ptrs + found, max - found);
+        for (size_t i = found; i < found + n; i++)
+            out_tiny_ptrs[i] = encode_tiny_ptr(container_index, (int)level, out_tiny_ptrs[i]);
+        found += n;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return found;
+}
+
+/* Buckets per level table; every level of every container has the same geometry */
+static size_t variable_table_buckets(const VariableTable *vt) {
+    SimpleGeometry g = {0};
+    if (vt && vt->container_count > 0)
+        simple_geometry(vt->containers[0].levels[0], &g);
+    return g.bucket_count;
+}
+
+/* Point cur->inner at the buckets of cur->table that fall inside the range, starting at global bucket begin */
+static void variable_cursor_enter(VariableTable *vt, VariableCursor *cur, size_t begin) {
+    size_t buckets = variable_table_buckets(vt);
+    size_t tables = vt->container_count * vt->level_count;
+    if (cur->table >= tables) {
+        simple_cursor_init(NULL, &cur->inner, 0, 0);
+        return;
+    }
+    size_t first = cur->table * buckets;
+    Container *c = &vt->containers[cur->table / vt->level_count];
+    simple_cursor_init(c->levels[cur->table % vt->level_count], &cur->inner,
+                       begin - first, cur->end_bucket - first);
+}
+
+/*
+ * The cursor numbers the buckets of all level tables in one sequence
+ * (table container * level_count + level, then bucket) and cuts it into
+ * parts, so a part may start or end in the middle of a level.
+ */
+void variable_cursor_init(VariableTable *vt, VariableCursor *cur, size_t part, size_t parts) {
+    if (!cur) return;
+    size_t total = vt ? vt->container_count * vt->level_count * variable_table_buckets(vt) : 0;
+    size_t begin = total, end = total;
+    if (parts > 0 && part < parts) {
+        begin = total / parts * part + total % parts * part / parts;
+        end = total / parts * (part + 1) + total % parts * (part + 1) / parts;
+    }
+    cur->end_bucket = end;
+    cur->table = SIZE_MAX;
+    simple_cursor_init(NULL, &cur->inner, 0, 0);
+    if (!vt || begin >= end) return;
+    cur->table = begin / variable_table_buckets(vt);
+    variable_cursor_enter(vt, cur, begin);
+}
+
+int variable_cursor_next(VariableTable *vt, VariableCursor *cur, int *key, int *value, int *tiny_ptr) {
+    if (!vt || !cur) return 0;
+    size_t buckets = variable_table_buckets(vt);
+    size_t tables = vt->container_count * vt->level_count;
+    while (cur->table < tables && cur->table * buckets < cur->end_bucket) {
+        Container *c = &vt->containers[cur->table / vt->level_count];
+        int level = (int)(cur->table % vt->level_count);
+        int more = cur->inner.pending != 0;
+        if (!more) {
+            pthread_mutex_lock(&c->lock);
+            more = simple_cursor_fill(c->levels[level], &cur->inner);
+            pthread_mutex_unlock(&c->lock);
+        }
+        int tp;
+        if (more && simple_cursor_next_unlocked(c->levels[level], &cur->inner, key, value, &tp)) {
+            if (tiny_ptr) *tiny_ptr = encode_tiny_ptr((int)(cur->table / vt->level_count), level, tp);
+            return 1;
+        }
+        cur->table++;
+        variable_cursor_enter(vt, cur, cur->table * buckets);
+    }
+    return 0;
+}
+
+typedef struct {
+    VariableTable *vt;
+    const int *keys;
+    const int *values;
+    int *out;
+    const size_t *order;         /* Item indices grouped by container */
+    const size_t *group_start;   /* container_count + 1 offsets into order */
+    size_t container_begin, container_end;
+    size_t placed;
+} VariableBulkWorker;
+
+/*
+ * Loads the items of a range of containers. Each container is private to
+ * one worker; its items go through the levels in order, and only the items
+ * that overflowed a level are offered to the next one.
+ */
+static void* variable_bulk_worker(void *arg) {
+    VariableBulkWorker *w = arg;
+    size_t max_group = 0;
+    for (size_t c = w->container_begin; c < w->container_end; c++) {
+        size_t m = w->group_start[c + 1] - w->group_start[c];
+        if (m > max_group) max_group = m;
+    }
+    if (max_group == 0) return NULL;
+    size_t *idx = malloc(max_group * sizeof(size_t));
+    int *keys = malloc(max_group * sizeof(int));
+    int *values = malloc(max_group * sizeof(int));
+    int *tps = malloc(max_group * sizeof(int));
+    if (!idx || !keys || !values || !tps) {
+        free(idx); free(keys); free(values); free(tps);
+        for (size_t k = w->group_start[w->container_begin]; k < w->group_start[w->container_end]; k++)
+            w->out[w->order[k]] = -1;
+        return NULL;
+    }
+    for (size_t c = w->container_begin; c < w->container_end; c++) {
+        Container *container = &w->vt->containers[c];
+        pthread_mutex_lock(&container->lock);
+        size_t m = 0;
+        for (size_t k = w->group_start[c]; k < w->group_start[c + 1]; k++) {
+            idx[m] = w->order[k];
+            keys[m] = w->keys[idx[m]];
+            values[m] = w->values[idx[m]];
+            m++;
+        }
+        for (size_t level = 0; level < container->level_count && m > 0; level++) {
+            w->placed += simple_bulk_load(container->levels[level], keys, values, m, tps, 1);
+            size_t remaining = 0;
+            for (size_t j = 0; j < m; j++) {
+                if (tps[j] != -1) {
+                    w->out[idx[j]] = encode_tiny_ptr((int)c, (int)level, tps[j]);
+                } else {
+                    idx[remaining] = idx[j];
+                    keys[remaining] = keys[j];
+                    values[remaining] = values[j];
+                    remaining++;
+                }
+            }
+            m = remaining;
+        }
+        pthread_mutex_unlock(&container->lock);
+        for (size_t j = 0; j < m; j++)
+            w->out[idx[j]] = -1;
+    }
+    free(idx); free(keys); free(values); free(tps);
+    return NULL;
+}
+
+/*
+ * variable_bulk_load groups the pairs by container and loads containers in
+ * parallel, nthreads workers each owning a contiguous range of containers.
+ */
+size_t variable_bulk_load(VariableTable *vt, const int *keys, const int *values, size_t n,
+                          int *out_tiny_ptrs, int nthreads) {
+    if (!vt || n == 0 || !keys || !values || !out_tiny_ptrs) return 0;
+    if (nthreads < 1) nthreads = 1;
+    if ((size_t)nthreads > vt->container_count) nthreads = (int)vt->container_count;
+    size_t *group_start = calloc(vt->container_count + 1, sizeof(size_t));
+    size_t *order = malloc(n * sizeof(size_t));
+    int *container_idx = malloc(n * sizeof(int));
+    VariableBulkWorker *workers = calloc(nthreads, sizeof(VariableBulkWorker));
+    pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+    if (!group_start || !order || !container_idx || !workers || !threads) {
+        free(group_start); free(order); free(container_idx); free(workers); free(threads);
+        return 0;
+    }
+    /* Counting sort of item indices by container */
+    for (size_t i = 0; i < n; i++) {
+        container_idx[i] = container_of(vt, keys[i]);
+        group_start[container_idx[i] + 1]++;
+    }
+    for (size_t c = 0; c < vt->container_count; c++)
+        group_start[c + 1] += group_start[c];
+    {
+        size_t *cursor = malloc(vt->container_count * sizeof(size_t));
+        if (!cursor) {
+            free(group_start); free(order); free(container_idx); free(workers); free(threads);
+            return 0;
+        }
+        for (size_t c = 0; c < vt->container_count; c++)
+            cursor[c] = group_start[c];
+        for (size_t i = 0; i < n; i++)
+            order[cursor[container_idx[i]]++] = i;
+        free(cursor);
+    }
+    size_t chunk = (vt->container_count + nthreads - 1) / nthreads;
+    int started = 0;
+    for (int t = 0; t < nthreads; t++) {
+        VariableBulkWorker *w = &workers[t];
+        w->vt = vt;
+        w->keys = keys;
+        w->values = values;
+        w->out = out_tiny_ptrs;
+        w->order = order;
+        w->group_start = group_start;
+        w->container_begin = t * chunk < vt->container_count ? t * chunk : vt->container_count;
+        w->container_end = w->container_begin + chunk < vt->container_count ? w->container_begin + chunk : vt->container_count;
+        if (nthreads > 1 && pthread_create(&threads[started], NULL, variable_bulk_worker, w) == 0)
+            started++;
+        else
+            variable_bulk_worker(w);
+    }
+    for (int t = 0; t < started; t++)
+        pthread_join(threads[t], NULL);
+    size_t placed = 0;
+    for (int t = 0; t < nthreads; t++)
+        placed += workers[t].placed;
+    free(group_start); free(order); free(container_idx); free(workers); free(threads);
+    return placed;
+}
+
+typedef struct {
+    int key;
+    int value;
+    int tiny_ptr;
+} VariableEntry;
+
+typedef struct {
+    VariableEntry *entries;
+    size_t count;
+    int container_index;   /* Position folded into the collected tiny pointers */
+    int level;
+} VariableCollector;
+
+static void collect_variable_entry(void *ctx, int key, int value, int tiny_ptr) {
+    VariableCollector *c = ctx;
+    c->entries[c->count++] = (VariableEntry){ key, value, encode_tiny_ptr(c->container_index, c->level, tiny_ptr) };
+}
+
+/*
+ * variable_compact rebuilds vt at the smallest total capacity that holds
+ * its live entries, keeping the ratio of container capacity to total
+ * capacity and the level count. It grows 25% per attempt on overflow.
+ * Returns the new table, or NULL if no smaller table fits; vt is left
+ * intact. The caller must keep allocate/free off vt meanwhile.
+ */
+VariableTable* variable_compact(VariableTable *vt, tiny_ptr_remap_fn remap, void *ctx) {
+    if (!vt) return NULL;
+    size_t live = 0;
+    for (size_t c = 0; c < vt->container_count; c++)
+        for (size_t level = 0; level < vt->containers[c].level_count; level++)
+            live += simple_live_count(vt->containers[c].levels[level]);
+    VariableCollector collector = { malloc((live ? live : 1) * sizeof(VariableEntry)), 0, 0, 0 };
+    int *new_tps = malloc((live ? live : 1) * sizeof(int));
+    if (!collector.entries || !new_tps) {
+        free(collector.entries); free(new_tps);
+        return NULL;
+    }
+    for (size_t c = 0; c < vt->container_count; c++) {
+        collector.container_index = (int)c;
+        for (size_t level = 0; level < vt->containers[c].level_count; level++) {
+            collector.level = (int)level;
+            simple_visit(vt->containers[c].levels[level], collect_variable_entry, &collector);
+        }
+    }
+
+    VariableTable *new_vt = NULL;
+    size_t target = live ? live : 1;
+    while (target < vt->total_capacity) {
+        size_t container_capacity = vt->container_capacity * target / vt->total_capacity;
+        if (container_capacity == 0) container_capacity = 1;
+        new_vt = variable_create(target, container_capacity, vt->level_count);
+        if (!new_vt) break;
+        size_t i;
+        for (i = 0; i < live; i++) {
+            new_tps[i] = variable_allocate(new_vt, collector.entries[i].key, collector.entries[i].value);
+            if (new_tps[i] == -1) break;
+        }
+        if (i == live) break;
+        variable_destroy(new_vt);
+        new_vt = NULL;
+        target += target / 4 + 1;
+    }
+    if (new_vt && remap) {
+        for (size_t i = 0; i < live; i++) {
+            if (new_tps[i] != collector.entries[i].tiny_ptr)
+                remap(ctx, collector.entries[i].key, collector.entries[i].tiny_ptr, new_tps[i]);
+        }
+    }
+    free(collector.entries);
+    free(new_tps);
+    return new_vt;
+}
+
+size_t variable_memory_usage(const VariableTable *vt) {
+    if (!vt) return 0;
+    size_t bytes = sizeof(VariableTable) + vt->container_count * sizeof(Container);
+    for (size_t i = 0; i < vt->container_count; i++) {
+        const Container *c = &vt->containers[i];
+        bytes += c->level_count * sizeof(SimpleTable*);
+        for (size_t level = 0; level < c->level_count; level++)
+            bytes += simple_memory_usage(c->levels[level]);
+    }
+    return bytes;
+}
+
+/*
+ * Frozen VariableTable: this header, one offset per (container, level)
+ * image in container-major order, then the level images. The container and
+ * level come straight from the tiny pointer, so no container hash is needed.
+ */
+typedef struct {
+    uint64_t container_count;
+    uint64_t level_count;
+} FrozenVariableHeader;
+
+void* variable_freeze(VariableTable *vt, size_t *out_size) {
+    if (!vt || !out_size) return NULL;
+    size_t count = vt->container_count * vt->level_count;
+    void **levels = calloc(count, sizeof(void *));
+    size_t *sizes = calloc(count, sizeof(size_t));
+    if (!levels || !sizes) {
+        free(levels); free(sizes);
+        return NULL;
+    }
+    size_t size = sizeof(FrozenVariableHeader) + count * sizeof(uint64_t);
+    int ok = 1;
+    for (size_t c = 0; c < vt->container_count && ok; c++) {
+        pthread_mutex_lock(&vt->containers[c].lock);
+        for (size_t level = 0; level < vt->level_count; level++) {
+            size_t i = c * vt->level_count + level;
+            levels[i] = simple_freeze(vt->containers[c].levels[level], &sizes[i]);
+            if (!levels[i]) { ok = 0; break; }
+            size += sizes[i];
+        }
+        pthread_mutex_unlock(&vt->containers[c].lock);
+    }
+    unsigned char *image = ok ? malloc(size) : NULL;
+    if (image) {
+        FrozenVariableHeader *h = (FrozenVariableHeader *)image;
+        h->container_count = vt->container_count;
+        h->level_count = vt->level_count;
+        uint64_t *offsets = (uint64_t *)(h + 1);
+        uint64_t offset = sizeof(FrozenVariableHeader) + count * sizeof(uint64_t);
+        for (size_t i = 0; i < count; i++) {
+            offsets[i] = offset;
+            memcpy(image + offset, levels[i], sizes[i]);
+            offset += sizes[i];
+        }
+        *out_size = size;
+    }
+    for (size_t i = 0; i < count; i++)
+        free(levels[i]);
+    free(levels);
+    free(sizes);
+    return image;
+}
+
+int variable_frozen_check(const void *image, size_t size) {
+    if (!image || size < sizeof(FrozenVariableHeader)) return -1;
+    const FrozenVariableHeader *h = image;
+    size_t room = (size - sizeof(FrozenVariableHeader)) / sizeof(uint64_t);
+    if (h->container_count == 0 || h->level_count == 0 || h->level_count > room ||
+        h->container_count > room / h->level_count)
+        return -1;
+    size_t count = (size_t)(h->container_count * h->level_count);
+    size_t offset = sizeof(FrozenVariableHeader) + count * sizeof(uint64_t);
+    const uint64_t *offsets = (const uint64_t *)(h + 1);
+    /* The level images follow the offsets back to back and fill the rest */
+    for (size_t i = 0; i < count; i++) {
+        if (offsets[i] != offset) return -1;
+        size_t level_size = simple_frozen_check((const unsigned char *)image + offset, size - offset);
+        if (level_size == 0) return -1;
+        offset += level_size;
+    }
+    return offset == size ? 0 : -1;
+}
+
+int variable_frozen_dereference(const void *image, int key, int tiny_ptr) {
+    if (!image) return -1;
+    const FrozenVariableHeader *h = image;
+    uint32_t container_index = (tiny_ptr >> (VARIABLE_SLOT_BITS + VARIABLE_LEVEL_BITS)) & 0xFF;
+    uint32_t level = (tiny_ptr >> VARIABLE_SLOT_BITS) & 0xF;
+    if (container_index >= h->container_count || level >= h->level_count) return -1;
+    const uint64_t *offsets = (const uint64_t *)(h + 1);
+    uint64_t offset = offsets[container_index * h->level_count + level];
+    return simple_frozen_dereference((const unsigned char *)image + offset, key, tiny_ptr & 0x3F);
+}
@@ -0,0 +1,122 @@
+#include "tiny_ptr.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <map>
+
+// Test 1: Pointer widths and pointer types follow from the template parameters.
+TEST(TinyPtrCpp, CompileTimeGeometry) {
+    static_assert(tiny_ptr::SimpleTable<int, int, 32>::pointer_bits == 5);
+    static_assert(tiny_ptr::SimpleTable<int, int, 64>::pointer_bits == 6);
+    static_assert(tiny_ptr::SimpleTable<int, int, 12>::pointer_bits == 4);
+    static_assert(sizeof(tiny_ptr::SimpleTable<int, int, 64>::pointer) == 1);
+    static_assert(tiny_ptr::FixedTable<int, int, 32>::pointer_bits == 6);
+    static_assert(tiny_ptr::VariableTable<int, int, 16, 4>::pointer_bits == 8 + 2 + 4);
+    static_assert(sizeof(tiny_ptr::VariableTable<int, int, 16, 4>::pointer) == 2);
+    static_assert(!std::is_copy_constructible_v<tiny_ptr::SimpleTable<int, int>>);
+    static_assert(std::is_nothrow_move_constructible_v<tiny_ptr::SimpleTable<int, int>>);
+    EXPECT_THROW((tiny_ptr::SimpleTable<int, int>(0)), std::invalid_argument);
+}
+
+// Test 2: Basic allocation, dereference and free.
+TEST(TinyPtrCpp, SimpleBasicAllocation) {
+    tiny_ptr::SimpleTable<int, long, 16> table(1024);
+    auto tp = table.allocate(123, 456L);
+    ASSERT_TRUE(tp.has_value());
+    EXPECT_EQ(table.dereference(123, *tp), 456L);
+    EXPECT_EQ(table.size(), 1u);
+    table.free(123, *tp);
+    EXPECT_EQ(table.dereference(123, *tp), 0L);
+    EXPECT_EQ(table.size(), 0u);
+}
+
+// Test 3: A bucket fills up after BucketSize allocations of one key.
+TEST(TinyPtrCpp, SimpleBucketFull) {
+    tiny_ptr::SimpleTable<int, int, 12, tiny_ptr::NullLock> table(1024);
+    for (int i = 0; i < 12; i++) {
+        ASSERT_TRUE(table.allocate(7, i).has_value());
+    }
+    EXPECT_FALSE(table.allocate(7, 99).has_value());
+}
+
+// Test 4: Moving a table keeps its entries.
+TEST(TinyPtrCpp, MoveOnly) {
+    tiny_ptr::SimpleTable<int, int> a(1024);
+    auto tp = a.allocate(5, 50);
+    ASSERT_TRUE(tp.has_value());
+    tiny_ptr::SimpleTable<int, int> b(std::move(a));
+    EXPECT_EQ(b.dereference(5, *tp), 50);
+    tiny_ptr::SimpleTable<int, int> c(16);
+    c = std::move(b);
+    EXPECT_EQ(c.dereference(5, *tp), 50);
+}
+
+// Test 5: Tables convert to and from C tables with every tiny pointer preserved.
+TEST(TinyPtrCpp, InteropWithC) {
+    ::SimpleTable* st = simple_create_sized(4096, 0.9, 32);
+    ASSERT_NE(st, nullptr);
+    std::map<int, int> tps;
+    for (int i = 0; i < 3000; i++) {
+        int tp = simple_allocate(st, i + 1000, i * 2);
+        if (tp != -1) tps[i + 1000] = tp;
+    }
+    auto table = tiny_ptr::SimpleTable<int, int, 32>::from_c(st);
+    EXPECT_EQ(table.size(), tps.size());
+    for (auto& kv : tps) {
+        EXPECT_EQ(table.dereference(kv.first, kv.second), (kv.first - 1000) * 2);
+    }
+    ::SimpleTable* back = table.to_c();
+    for (auto& kv : tps) {
+        EXPECT_EQ(simple_dereference(back, kv.first, kv.second), (kv.first - 1000) * 2);
+    }
+    EXPECT_EQ(simple_live_count(back), tps.size());
+    EXPECT_THROW((tiny_ptr::SimpleTable<int, int, 16>::from_c(st)), std::invalid_argument);
+    simple_destroy(back);
+    simple_destroy(st);
+}
+
+// Test 6: Fixed table spills into the secondary table when a primary bucket is full.
+TEST(TinyPtrCpp, FixedOverflow) {
+    tiny_ptr::FixedTable<int, int, 8> table(1024);
+    std::vector<int> tps;
+    for (int i = 0; i < 16; i++) {
+        auto tp = table.allocate(42, i);
+        ASSERT_TRUE(tp.has_value());
+        tps.push_back(*tp);
+    }
+    EXPECT_EQ(tps[7] & 1, 0);
+    EXPECT_EQ(tps[8] & 1, 1);
+    for (int i = 0; i < 16; i++) {
+        EXPECT_EQ(table.dereference(42, tps[i]), i);
+    }
+    EXPECT_FALSE(table.allocate(42, 16).has_value());
+    table.free(42, tps[8]);
+    EXPECT_TRUE(table.allocate(42, 17).has_value());
+}
+
+// Test 7: Variable table under concurrent writers.
+TEST(TinyPtrCpp, VariableMultiThreaded) {
+    tiny_ptr::VariableTable<int, int, 16, 4> table(16384, 1024);
+    EXPECT_EQ(table.container_count(), 16u);
+    const int num_threads = 4, allocs_per_thread = 1000;
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&table, t, &failures]() {
+            for (int i = 0; i < allocs_per_thread; i++) {
+                int key = t * allocs_per_thread + i;
+                auto tp = table.allocate(key, key * 10);
+                if (!tp) { failures++; continue; }
+                if (table.dereference(key, *tp) != key * 10) failures++;
+            }
+        });
+    }
+    for (auto& th : threads) { th.join(); }
+    EXPECT_EQ(failures.load(), 0);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,148 @@
+extern "C" {
+    #include "tiny_ptr_list.h"
+}
+#include <gtest/gtest.h>
+#include <list>
+#include <vector>
+#include <random>
+#include <iterator>
+
+static std::vector<int> contents(const TinyList* list) {
+    std::vector<int> out;
+    for (TinyListPos p = tiny_list_begin(list); p.tiny_ptr >= 0; p = tiny_list_next(list, p))
+        out.push_back(tiny_list_value(list, p));
+    return out;
+}
+
+// Test 1: Operations on a NULL list.
+TEST(TinyList, NullListOperations) {
+    int value;
+    EXPECT_EQ(tiny_list_push_front(nullptr, 1), -1);
+    EXPECT_EQ(tiny_list_push_back(nullptr, 1), -1);
+    EXPECT_EQ(tiny_list_pop_front(nullptr, &value), -1);
+    EXPECT_EQ(tiny_list_begin(nullptr).tiny_ptr, -1);
+    EXPECT_EQ(tiny_list_size(nullptr), 0u);
+}
+
+// Test 2: Pushes at both ends and pops from the front keep the order.
+TEST(TinyList, PushAndPop) {
+    TinyList* list = tiny_list_create(256, 0.9);
+    ASSERT_NE(list, nullptr);
+    EXPECT_EQ(tiny_list_begin(list).tiny_ptr, -1);
+    for (int i = 0; i < 5; i++) ASSERT_EQ(tiny_list_push_back(list, i), 0);
+    ASSERT_EQ(tiny_list_push_front(list, -1), 0);
+    EXPECT_EQ(contents(list), (std::vector<int>{-1, 0, 1, 2, 3, 4}));
+    int value = 0;
+    ASSERT_EQ(tiny_list_pop_front(list, &value), 0);
+    EXPECT_EQ(value, -1);
+    EXPECT_EQ(tiny_list_size(list), 5u);
+    while (tiny_list_pop_front(list, nullptr) == 0) {}
+    EXPECT_EQ(tiny_list_size(list), 0u);
+    ASSERT_EQ(tiny_list_push_back(list, 9), 0);
+    EXPECT_EQ(contents(list), (std::vector<int>{9}));
+    tiny_list_destroy(list);
+}
+
+// Test 3: Positions stay valid across inserts and erases elsewhere in the list.
+TEST(TinyList, StablePositions) {
+    TinyList* list = tiny_list_create(256, 0.9);
+    ASSERT_NE(list, nullptr);
+    TinyListPos a, b, c;
+    ASSERT_EQ(tiny_list_insert_after(list, tiny_list_before_begin(list), 1, &a), 0);
+    ASSERT_EQ(tiny_list_insert_after(list, a, 3, &c), 0);
+    ASSERT_EQ(tiny_list_insert_after(list, a, 2, &b), 0);
+    EXPECT_EQ(contents(list), (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(tiny_list_value(list, c), 3);
+    ASSERT_EQ(tiny_list_erase_after(list, a), 0);
+    EXPECT_EQ(tiny_list_value(list, a), 1);
+    EXPECT_EQ(tiny_list_value(list, c), 3);
+    EXPECT_EQ(tiny_list_erase_after(list, c), -1);
+    ASSERT_EQ(tiny_list_push_back(list, 4), 0);
+    EXPECT_EQ(contents(list), (std::vector<int>{1, 3, 4}));
+    tiny_list_destroy(list);
+}
+
+// Test 4: The list grows past its initial capacity and keeps its order.
+TEST(TinyList, GrowsPastCapacity) {
+    TinyList* list = tiny_list_create(32, 0.9);
+    ASSERT_NE(list, nullptr);
+    std::vector<int> expected;
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_EQ(tiny_list_push_back(list, i), 0);
+        expected.push_back(i);
+    }
+    EXPECT_EQ(tiny_list_size(list), 10000u);
+    EXPECT_EQ(contents(list), expected);
+    tiny_list_destroy(list);
+}
+
+// Test 5: Random edits agree with std::list.
+TEST(TinyList, MatchesStdList) {
+    TinyList* list = tiny_list_create(4096, 0.9);
+    ASSERT_NE(list, nullptr);
+    std::list<int> reference;
+    std::mt19937 rng(777);
+    for (int i = 0; i < 3000; i++) {
+        size_t index = rng() % (reference.size() + 1);
+        TinyListPos pos = tiny_list_before_begin(list);
+        for (size_t k = 0; k < index; k++) pos = tiny_list_next(list, pos);
+        auto ref = reference.begin();
+        std::advance(ref, index);
+        if (rng() % 3 != 0 || ref == reference.end()) {
+            ASSERT_EQ(tiny_list_insert_after(list, pos, i, nullptr), 0);
+            reference.insert(ref, i);
+        } else {
+            ASSERT_EQ(tiny_list_erase_after(list, pos), 0);
+            reference.erase(ref);
+        }
+    }
+    EXPECT_EQ(contents(list), std::vector<int>(reference.begin(), reference.end()));
+    EXPECT_EQ(tiny_list_size(list), reference.size());
+    tiny_list_destroy(list);
+}
+
+// Test 6: Long runs inserted at fixed spots, then thinned out, agree with std::list.
+TEST(TinyList, RunsAtFixedSpots) {
+    TinyList* list = tiny_list_create(1024, 0.9);
+    ASSERT_NE(list, nullptr);
+    std::list<int> reference;
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(tiny_list_push_back(list, i), 0);
+        reference.push_back(i);
+    }
+    TinyListPos at = tiny_list_before_begin(list);
+    for (int k = 0; k < 500; k++) at = tiny_list_next(list, at);
+    auto ref = std::next(reference.begin(), 500);
+    for (int i = 0; i < 20000; i++) {
+        ASSERT_EQ(tiny_list_insert_after(list, at, 1000 + i, &at), 0);
+        reference.insert(ref, 1000 + i);
+    }
+    for (int i = 0; i < 20000; i++) {
+        ASSERT_EQ(tiny_list_push_front(list, -i), 0);
+        reference.push_front(-i);
+    }
+    EXPECT_EQ(contents(list), std::vector<int>(reference.begin(), reference.end()));
+    // Erasing every other node joins neighbours whose keys lie far apart.
+    TinyListPos pos = tiny_list_before_begin(list);
+    while (tiny_list_erase_after(list, pos) == 0) {
+        pos = tiny_list_next(list, pos);
+        if (pos.tiny_ptr < 0) break;
+    }
+    for (auto it = reference.begin(); it != reference.end();) {
+        it = reference.erase(it);
+        if (it != reference.end()) ++it;
+    }
+    EXPECT_EQ(contents(list), std::vector<int>(reference.begin(), reference.end()));
+    EXPECT_EQ(tiny_list_size(list), reference.size());
+    while (tiny_list_pop_front(list, nullptr) == 0) {}
+    EXPECT_EQ(tiny_list_size(list), 0u);
+    EXPECT_EQ(tiny_list_begin(list).tiny_ptr, -1);
+    ASSERT_EQ(tiny_list_push_back(list, 5), 0);
+    EXPECT_EQ(contents(list), (std::vector<int>{5}));
+    tiny_list_destroy(list);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
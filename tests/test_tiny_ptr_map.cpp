@@ -0,0 +1,90 @@
+extern "C" {
+    #include "tiny_ptr_map.h"
+}
+#include <gtest/gtest.h>
+#include <unordered_map>
+#include <random>
+
+// Test 1: Operations on a NULL map.
+TEST(TinyMap, NullMapOperations) {
+    int value;
+    EXPECT_EQ(tiny_map_put(nullptr, 1, 1), -1);
+    EXPECT_EQ(tiny_map_get(nullptr, 1, &value), -1);
+    EXPECT_EQ(tiny_map_erase(nullptr, 1), -1);
+    EXPECT_EQ(tiny_map_size(nullptr), 0u);
+    EXPECT_EQ(tiny_map_create(0, 0.9), nullptr);
+}
+
+// Test 2: Put, get, overwrite and erase.
+TEST(TinyMap, PutGetEraseOverwrite) {
+    TinyMap* map = tiny_map_create(128, 0.9);
+    ASSERT_NE(map, nullptr);
+    int value = 0;
+    EXPECT_EQ(tiny_map_get(map, 7, &value), -1);
+    EXPECT_EQ(tiny_map_put(map, 7, 70), 0);
+    EXPECT_EQ(tiny_map_get(map, 7, &value), 0);
+    EXPECT_EQ(value, 70);
+    EXPECT_EQ(tiny_map_put(map, 7, 71), 0);
+    EXPECT_EQ(tiny_map_size(map), 1u);
+    EXPECT_EQ(tiny_map_get(map, 7, &value), 0);
+    EXPECT_EQ(value, 71);
+    EXPECT_EQ(tiny_map_erase(map, 7), 0);
+    EXPECT_EQ(tiny_map_erase(map, 7), -1);
+    EXPECT_EQ(tiny_map_get(map, 7, &value), -1);
+    EXPECT_EQ(tiny_map_size(map), 0u);
+    tiny_map_destroy(map);
+}
+
+// Test 3: The map grows past its initial capacity and keeps every entry.
+TEST(TinyMap, GrowsPastCapacity) {
+    TinyMap* map = tiny_map_create(64, 0.9);
+    ASSERT_NE(map, nullptr);
+    size_t initial_bytes = tiny_map_memory_usage(map);
+    for (int i = 0; i < 20000; i++) {
+        ASSERT_EQ(tiny_map_put(map, i * 31, i), 0);
+    }
+    EXPECT_EQ(tiny_map_size(map), 20000u);
+    EXPECT_GT(tiny_map_memory_usage(map), initial_bytes);
+    for (int i = 0; i < 20000; i++) {
+        int value = -1;
+        ASSERT_EQ(tiny_map_get(map, i * 31, &value), 0);
+        EXPECT_EQ(value, i);
+    }
+    tiny_map_destroy(map);
+}
+
+// Test 4: Random operations agree with std::unordered_map.
+TEST(TinyMap, MatchesUnorderedMap) {
+    TinyMap* map = tiny_map_create(1024, 0.9);
+    ASSERT_NE(map, nullptr);
+    std::unordered_map<int, int> reference;
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> key_dist(-5000, 5000);
+    for (int i = 0; i < 50000; i++) {
+        int key = key_dist(rng);
+        switch (rng() % 3) {
+        case 0:
+            ASSERT_EQ(tiny_map_put(map, key, i), 0);
+            reference[key] = i;
+            break;
+        case 1:
+            EXPECT_EQ(tiny_map_erase(map, key), reference.erase(key) ? 0 : -1);
+            break;
+        default: {
+            int value = 0;
+            auto it = reference.find(key);
+            ASSERT_EQ(tiny_map_get(map, key, &value), it == reference.end() ? -1 : 0);
+            if (it != reference.end()) {
+                EXPECT_EQ(value, it->second);
+            }
+        }
+        }
+    }
+    EXPECT_EQ(tiny_map_size(map), reference.size());
+    tiny_map_destroy(map);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
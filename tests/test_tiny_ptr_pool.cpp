@@ -0,0 +1,130 @@
+extern "C" {
+    #include "tiny_ptr_pool.h"
+}
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <map>
+#include <cstdint>
+#include <cstring>
+
+struct Object {
+    long id;
+    double weight;
+    char name[20];
+};
+
+// Test 1: Operations on a NULL pool.
+TEST(TinyPool, NullPoolOperations) {
+    EXPECT_EQ(tiny_pool_alloc(nullptr, 1), -1);
+    EXPECT_EQ(tiny_pool_deref(nullptr, 1, 0), nullptr);
+    tiny_pool_free(nullptr, 1, 0);
+    EXPECT_EQ(tiny_pool_create(1024, 0, 0.9), nullptr);
+}
+
+// Test 2: An allocated object is zeroed, aligned and keeps what is written to it.
+TEST(TinyPool, BasicAllocation) {
+    TinyPool* pool = tiny_pool_create(1024, sizeof(Object), 0.9);
+    ASSERT_NE(pool, nullptr);
+    EXPECT_EQ(tiny_pool_stride(pool) % 16, 0u);
+    int tp = tiny_pool_alloc(pool, 77);
+    ASSERT_NE(tp, -1);
+    Object* obj = static_cast<Object*>(tiny_pool_deref(pool, 77, tp));
+    ASSERT_NE(obj, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(obj) % 16, 0u);
+    EXPECT_EQ(obj->id, 0);
+    obj->id = 42;
+    obj->weight = 1.5;
+    std::strcpy(obj->name, "tiny");
+    Object* again = static_cast<Object*>(tiny_pool_deref(pool, 77, tp));
+    EXPECT_EQ(again, obj);
+    EXPECT_EQ(again->id, 42);
+    EXPECT_STREQ(again->name, "tiny");
+    EXPECT_EQ(tiny_pool_live_count(pool), 1u);
+    tiny_pool_free(pool, 77, tp);
+    EXPECT_EQ(tiny_pool_live_count(pool), 0u);
+    tiny_pool_destroy(pool);
+}
+
+// Test 3: Live objects never overlap.
+TEST(TinyPool, DistinctObjects) {
+    TinyPool* pool = tiny_pool_create(4096, sizeof(Object), 0.9);
+    ASSERT_NE(pool, nullptr);
+    std::map<int, int> tps;
+    for (int i = 0; i < 3000; i++) {
+        int tp = tiny_pool_alloc(pool, i);
+        if (tp == -1) continue;
+        tps[i] = tp;
+        static_cast<Object*>(tiny_pool_deref(pool, i, tp))->id = i;
+    }
+    for (auto& kv : tps) {
+        EXPECT_EQ(static_cast<Object*>(tiny_pool_deref(pool, kv.first, kv.second))->id, kv.first);
+    }
+    tiny_pool_destroy(pool);
+}
+
+// Test 4: A freed slot is reused and handed out zeroed again.
+TEST(TinyPool, ReuseAfterFree) {
+    TinyPool* pool = tiny_pool_create(1024, sizeof(Object), 0.9);
+    ASSERT_NE(pool, nullptr);
+    std::vector<int> tps;
+    int tp;
+    while ((tp = tiny_pool_alloc(pool, 5)) != -1) {
+        static_cast<Object*>(tiny_pool_deref(pool, 5, tp))->id = 99;
+        tps.push_back(tp);
+    }
+    ASSERT_FALSE(tps.empty());
+    tiny_pool_free(pool, 5, tps[0]);
+    int reused = tiny_pool_alloc(pool, 5);
+    EXPECT_EQ(reused, tps[0]);
+    EXPECT_EQ(static_cast<Object*>(tiny_pool_deref(pool, 5, reused))->id, 0);
+    tiny_pool_destroy(pool);
+}
+
+// Test 5: Concurrent allocation from several threads hands out each object once.
+TEST(TinyPool, MultiThreaded) {
+    TinyPool* pool = tiny_pool_create(16384, sizeof(Object), 0.9);
+    ASSERT_NE(pool, nullptr);
+    const int num_threads = 4, allocs_per_thread = 2000;
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([pool, t, &failures]() {
+            for (int i = 0; i < allocs_per_thread; i++) {
+                int key = i % 64;
+                int tp = tiny_pool_alloc(pool, key);
+                if (tp == -1) continue;
+                Object* obj = static_cast<Object*>(tiny_pool_deref(pool, key, tp));
+                obj->id = t * allocs_per_thread + i;
+                if (obj->id != t * allocs_per_thread + i) failures++;
+                tiny_pool_free(pool, key, tp);
+            }
+        });
+    }
+    for (auto& th : threads) { th.join(); }
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(tiny_pool_live_count(pool), 0u);
+    tiny_pool_destroy(pool);
+}
+
+// Test 6: Out-of-range tiny pointers are rejected instead of addressing outside the slab.
+TEST(TinyPool, RejectsOutOfRangePointers) {
+    TinyPool* pool = tiny_pool_create(1024, sizeof(Object), 0.9);
+    ASSERT_NE(pool, nullptr);
+    int tp = tiny_pool_alloc(pool, 3);
+    ASSERT_NE(tp, -1);
+    EXPECT_EQ(tiny_pool_deref(pool, 3, -1), nullptr);
+    EXPECT_EQ(tiny_pool_deref(pool, 3, 64), nullptr);
+    EXPECT_EQ(tiny_pool_deref(pool, 3, 1 << 20), nullptr);
+    tiny_pool_free(pool, 3, 1 << 20);
+    EXPECT_EQ(tiny_pool_live_count(pool), 1u);
+    tiny_pool_free(pool, 3, tp);
+    EXPECT_EQ(tiny_pool_live_count(pool), 0u);
+    tiny_pool_destroy(pool);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
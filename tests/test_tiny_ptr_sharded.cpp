@@ -0,0 +1,285 @@
+extern "C" {
+    #include "tiny_ptr_unified.h"
+    #include "tiny_ptr_frozen.h"
+    #include "tiny_ptr_sharded.h"
+}
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+// Test 1: Operations on a NULL table.
+TEST(TinyPtrSharded, NullTableOperations) {
+    EXPECT_EQ(tiny_ptr_allocate(nullptr, 321, 654), -1);
+    EXPECT_EQ(tiny_ptr_dereference(nullptr, 321, 0), -1);
+    tiny_ptr_free(nullptr, 321, 0);
+}
+
+// Test 2: Basic allocation, dereference and free.
+TEST(TinyPtrSharded, BasicAllocation) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SHARDED, 0.9);
+    ASSERT_NE(table, nullptr);
+    for (int i = 0; i < 100; i++) {
+        int key = i + 1300;
+        int value = key * 10;
+        int tp = tiny_ptr_allocate(table, key, value);
+        EXPECT_NE(tp, -1) << "Allocation failed for key " << key;
+        EXPECT_EQ(tiny_ptr_dereference(table, key, tp), value)
+            << "Dereference mismatch for key " << key;
+        tiny_ptr_free(table, key, tp);
+        EXPECT_EQ(tiny_ptr_dereference(table, key, tp), 0)
+            << "Slot not reset after free for key " << key;
+    }
+    tiny_ptr_destroy(table);
+}
+
+// Test 3: Multiple allocations with the same key.
+TEST(TinyPtrSharded, MultipleAllocationsSameKey) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SHARDED, 0.9);
+    ASSERT_NE(table, nullptr);
+    int key = 5500;
+    int value1 = 321, value2 = 654;
+    int tp1 = tiny_ptr_allocate(table, key, value1);
+    EXPECT_NE(tp1, -1);
+    int tp2 = tiny_ptr_allocate(table, key, value2);
+    EXPECT_NE(tp2, -1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp1), value1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp2), value2);
+    tiny_ptr_free(table, key, tp1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp1), 0);
+    tiny_ptr_free(table, key, tp2);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp2), 0);
+    tiny_ptr_destroy(table);
+}
+
+// Test 4: Allocate until full.
+TEST(TinyPtrSharded, AllocateUntilFull) {
+    size_t capacity = 64;
+    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SHARDED, 0.9);
+    ASSERT_NE(table, nullptr);
+    std::vector<int> allocated;
+    int key = 2000, value = 20;
+    while (true) {
+        int tp = tiny_ptr_allocate(table, key, value);
+        if (tp == -1) break;
+        allocated.push_back(tp);
+        key++;
+        value += 20;
+    }
+    EXPECT_GT(allocated.size(), 0u);
+    key = 2000;
+    for (int tp : allocated) {
+        tiny_ptr_free(table, key, tp);
+        key++;
+    }
+    int new_tp = tiny_ptr_allocate(table, 8888, 88880);
+    EXPECT_NE(new_tp, -1);
+    tiny_ptr_destroy(table);
+}
+
+// Test 5: Multi-threaded operations.
+TEST(TinyPtrSharded, MultiThreaded) {
+    size_t capacity = 10000;
+    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SHARDED, 0.9);
+    ASSERT_NE(table, nullptr);
+    const int num_threads = 4, allocs_per_thread = 1000;
+    std::vector<std::thread> threads;
+    std::atomic<int> failures(0);
+    auto threadFunc = [table, allocs_per_thread, &failures](int start_key) {
+        for (int i = 0; i < allocs_per_thread; i++) {
+            int key = start_key + i;
+            int value = key * 10;
+            int tp = tiny_ptr_allocate(table, key, value);
+            if (tp == -1) { failures++; continue; }
+            if (tiny_ptr_dereference(table, key, tp) != value) { failures++; }
+            tiny_ptr_free(table, key, tp);
+        }
+    };
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(threadFunc, i * allocs_per_thread);
+    }
+    for (auto& t : threads) { t.join(); }
+    EXPECT_EQ(failures.load(), 0);
+    tiny_ptr_destroy(table);
+}
+
+// Test 6: Reallocation after free.
+TEST(TinyPtrSharded, ReallocateAfterFree) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SHARDED, 0.9);
+    ASSERT_NE(table, nullptr);
+    int key = 3500, value1 = 777, value2 = 888;
+    int tp = tiny_ptr_allocate(table, key, value1);
+    ASSERT_NE(tp, -1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp), value1);
+    tiny_ptr_free(table, key, tp);
+    int tp_new = tiny_ptr_allocate(table, key, value2);
+    EXPECT_NE(tp_new, -1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp_new), value2);
+    tiny_ptr_destroy(table);
+}
+
+// Test 7: Double free should not crash.
+TEST(TinyPtrSharded, DoubleFree) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SHARDED, 0.9);
+    ASSERT_NE(table, nullptr);
+    int key = 4500, value = 999;
+    int tp = tiny_ptr_allocate(table, key, value);
+    ASSERT_NE(tp, -1);
+    tiny_ptr_free(table, key, tp);
+    tiny_ptr_free(table, key, tp);
+    tiny_ptr_destroy(table);
+}
+
+// Test 8: Resizing one shard leaves the other shards' tiny pointers intact.
+TEST(TinyPtrSharded, ResizeOneShard) {
+    ShardedTable* sh = sharded_create(4096, 8, 0.9);
+    ASSERT_NE(sh, nullptr);
+    EXPECT_EQ(sharded_shard_count(sh), 8u);
+    const int count = 1000;
+    std::vector<int> tps(count);
+    for (int i = 0; i < count; i++) {
+        tps[i] = sharded_allocate(sh, i + 14000, i + 1);
+        ASSERT_NE(tps[i], -1);
+    }
+    ASSERT_EQ(sharded_resize_shard(sh, 3, 2048, 2), 0);
+    for (int i = 0; i < count; i++) {
+        int key = i + 14000;
+        if (sharded_shard_of(sh, key) == 3) continue;
+        EXPECT_EQ(sharded_dereference(sh, key, tps[i]), i + 1) << "Mismatch for key " << key;
+    }
+    sharded_destroy(sh);
+}
+
+// Test 9: Dereferences on every shard keep running while all shards resize.
+TEST(TinyPtrSharded, ResizeWithConcurrentReaders) {
+    ShardedTable* sh = sharded_create(4096, 4, 0.9);
+    ASSERT_NE(sh, nullptr);
+    for (int i = 0; i < 512; i++) {
+        ASSERT_NE(sharded_allocate(sh, i + 15000, i), -1);
+    }
+    std::atomic<bool> stop(false);
+    std::atomic<long> reads(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([sh, t, &stop, &reads]() {
+            int key = 15000 + t;
+            while (!stop.load()) {
+                sharded_dereference(sh, key, 0);
+                reads++;
+            }
+        });
+    }
+    while (reads.load() == 0) { std::this_thread::yield(); }
+    for (int round = 0; round < 20; round++) {
+        EXPECT_EQ(sharded_resize(sh, (round % 2 == 0) ? 8192 : 4096, 1), 0);
+    }
+    stop = true;
+    for (auto& t : readers) { t.join(); }
+    sharded_destroy(sh);
+}
+
+// Test 10: Scans running alongside shard resizes report every entry exactly once; resizing a scanned shard fails instead of waiting.
+TEST(TinyPtrSharded, CursorDuringResize) {
+    tiny_ptr_table_t* table = tiny_ptr_create(4096, TINY_PTR_SHARDED, 0.9);
+    ASSERT_NE(table, nullptr);
+    const int stable = 2000;
+    for (int i = 0; i < stable; i++) {
+        ASSERT_NE(tiny_ptr_allocate(table, i, i * 2), -1);
+    }
+    std::atomic<bool> stop{false};
+    std::thread resizer([&] {
+        for (int round = 0; !stop.load(); round++) {
+            tiny_ptr_resize(&table, round % 2 ? 4096 : 8192);
+        }
+    });
+    for (int scan = 0; scan < 20; scan++) {
+        std::vector<int> count(stable, 0);
+        TinyPtrCursor cur;
+        ASSERT_EQ(tiny_ptr_cursor_open(table, &cur, scan % 3, 3), 0);
+        int key, value;
+        while (tiny_ptr_cursor_next(&cur, &key, &value, nullptr)) {
+            ASSERT_GE(key, 0);
+            ASSERT_LT(key, stable);
+            EXPECT_EQ(value, key * 2);
+            count[key]++;
+        }
+        tiny_ptr_cursor_close(&cur);
+        EXPECT_EQ(std::count(count.begin(), count.end(), 2), 0);
+    }
+    size_t total = 0;
+    for (size_t p = 0; p < 3; p++) {
+        TinyPtrCursor cur;
+        ASSERT_EQ(tiny_ptr_cursor_open(table, &cur, p, 3), 0);
+        while (tiny_ptr_cursor_next(&cur, nullptr, nullptr, nullptr)) total++;
+        tiny_ptr_cursor_close(&cur);
+    }
+    EXPECT_EQ(total, (size_t)stable);
+    stop = true;
+    resizer.join();
+    EXPECT_EQ(tiny_ptr_resize(&table, 8192), 0);
+    tiny_ptr_destroy(table);
+}
+
+// Test 11: Only the shard a cursor is inside refuses to resize, and the cursor can be closed from another thread.
+TEST(TinyPtrSharded, CursorBlocksOnlyItsShard) {
+    ShardedTable* sh = sharded_create(4096, 4, 0.9);
+    ASSERT_NE(sh, nullptr);
+    for (int i = 0; i < 2000; i++) {
+        sharded_allocate(sh, i, i);
+    }
+    ShardedCursor cur;
+    sharded_cursor_init(sh, &cur, 0, 1);
+    ASSERT_EQ(sharded_cursor_next(sh, &cur, nullptr, nullptr, nullptr), 1);
+    size_t inside = cur.shard;
+    for (size_t s = 0; s < sharded_shard_count(sh); s++) {
+        EXPECT_EQ(sharded_resize_shard(sh, s, 2048, 1), s == inside ? -1 : 0);
+    }
+    EXPECT_EQ(sharded_compact(sh, nullptr, nullptr), -1);
+    std::thread closer([&] { sharded_cursor_close(sh, &cur); });
+    closer.join();
+    EXPECT_EQ(sharded_resize_shard(sh, inside, 2048, 1), 0);
+    EXPECT_EQ(sharded_compact(sh, nullptr, nullptr), 0);
+    sharded_destroy(sh);
+}
+
+// Test 12: Opening a frozen image rejects corrupt shard offsets and shard counts.
+TEST(TinyPtrSharded, FrozenImageValidated) {
+    tiny_ptr_table_t* table = tiny_ptr_create(4096, TINY_PTR_SHARDED, 0.9);
+    ASSERT_NE(table, nullptr);
+    for (int i = 0; i < 2000; i++) tiny_ptr_allocate(table, i, i);
+    tiny_ptr_frozen_t* frozen = tiny_ptr_freeze(table);
+    ASSERT_NE(frozen, nullptr);
+    tiny_ptr_destroy(table);
+    size_t size = 0;
+    const void* data = tiny_ptr_frozen_data(frozen, &size);
+    std::vector<uint64_t> good((size + 7) / 8);
+    memcpy(good.data(), data, size);
+    tiny_ptr_frozen_destroy(frozen);
+    // 64-bit words: shard_bits right after the 24-byte outer header, then one offset per shard
+    const size_t shard_bits = 3, first_offset = 4;
+    auto opens = [&](const std::vector<uint64_t>& bytes) {
+        tiny_ptr_frozen_t* f = tiny_ptr_frozen_open(bytes.data(), size);
+        tiny_ptr_frozen_destroy(f);
+        return f != nullptr;
+    };
+    EXPECT_TRUE(opens(good));
+    std::vector<uint64_t> bad = good;
+    bad[first_offset] += 8;
+    EXPECT_FALSE(opens(bad));
+    bad = good;
+    bad[first_offset] = size * 2;
+    EXPECT_FALSE(opens(bad));
+    bad = good;
+    bad[shard_bits] += 1;
+    EXPECT_FALSE(opens(bad));
+    bad = good;
+    bad[shard_bits] = 60;
+    EXPECT_FALSE(opens(bad));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
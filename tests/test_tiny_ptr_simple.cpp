@@ -1,160 +1,546 @@
-extern "C" {
-    #include "tiny_ptr_unified.h"
-}
-#include <gtest/gtest.h>
-#include <thread>
-#include <vector>
-#include <atomic>
-
-// Test 1: Operations on a NULL table.
-TEST(TinyPtrSimple, NullTableOperations) {
-    EXPECT_EQ(tiny_ptr_allocate(nullptr, 123, 456), -1);
-    EXPECT_EQ(tiny_ptr_dereference(nullptr, 123, 0), -1);
-    // tiny_ptr_free is void; calling it on a null table should not crash.
-    tiny_ptr_free(nullptr, 123, 0);
-}
-
-// Test 2: Basic allocation, dereference and free.
-TEST(TinyPtrSimple, BasicAllocation) {
-    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
-    ASSERT_NE(table, nullptr);
-    for (int i = 0; i < 100; i++) {
-        int key = i + 1000;
-        int value = key * 10;
-        int tp = tiny_ptr_allocate(table, key, value);
-        EXPECT_NE(tp, -1) << "Allocation failed for key " << key;
-        int ret = tiny_ptr_dereference(table, key, tp);
-        EXPECT_EQ(ret, value) << "Dereference mismatch for key " << key;
-        tiny_ptr_free(table, key, tp);
-        ret = tiny_ptr_dereference(table, key, tp);
-        EXPECT_EQ(ret, 0) << "Slot not reset after free for key " << key;
-    }
-    tiny_ptr_destroy(table);
-}
-
-// Test 3: Multiple allocations with the same key.
-TEST(TinyPtrSimple, MultipleAllocationsSameKey) {
-    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
-    ASSERT_NE(table, nullptr);
-    int key = 5000;
-    int value1 = 123, value2 = 456;
-    int tp1 = tiny_ptr_allocate(table, key, value1);
-    EXPECT_NE(tp1, -1);
-    int tp2 = tiny_ptr_allocate(table, key, value2);
-    EXPECT_NE(tp2, -1);
-    EXPECT_EQ(tiny_ptr_dereference(table, key, tp1), value1);
-    EXPECT_EQ(tiny_ptr_dereference(table, key, tp2), value2);
-    tiny_ptr_free(table, key, tp1);
-    EXPECT_EQ(tiny_ptr_dereference(table, key, tp1), 0);
-    tiny_ptr_free(table, key, tp2);
-    EXPECT_EQ(tiny_ptr_dereference(table, key, tp2), 0);
-    tiny_ptr_destroy(table);
-}
-
-// Test 4: Allocate until full and then free.
-TEST(TinyPtrSimple, AllocateUntilFull) {
-    size_t capacity = 64; // small capacity to force failure quickly
-    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SIMPLE, 0.9);
-    ASSERT_NE(table, nullptr);
-    std::vector<int> allocated;
-    int key = 1000, value = 10;
-    while (true) {
-        int tp = tiny_ptr_allocate(table, key, value);
-        if (tp == -1) break;
-        allocated.push_back(tp);
-        key++;
-        value += 10;
-    }
-    EXPECT_GT(allocated.size(), 0u);
-    key = 1000;
-    for (int tp : allocated) {
-        tiny_ptr_free(table, key, tp);
-        key++;
-    }
-    int new_tp = tiny_ptr_allocate(table, 9999, 99990);
-    EXPECT_NE(new_tp, -1);
-    tiny_ptr_destroy(table);
-}
-
-// Test 5: Resize test (SIMPLE variant only).
-TEST(TinyPtrSimple, ResizeTest) {
-    size_t capacity = 128;
-    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SIMPLE, 0.9);
-    ASSERT_NE(table, nullptr);
-    int half = capacity / 2;
-    for (int i = 0; i < half; i++) {
-        int key = i + 2000;
-        int value = key * 10;
-        int tp = tiny_ptr_allocate(table, key, value);
-        EXPECT_NE(tp, -1);
-    }
-    EXPECT_EQ(tiny_ptr_resize(&table, capacity * 2), 0);
-    for (int i = half; i < (int)capacity; i++) {
-        int key = i + 2000;
-        int value = key * 10;
-        int tp = tiny_ptr_allocate(table, key, value);
-        EXPECT_NE(tp, -1);
-        EXPECT_EQ(tiny_ptr_dereference(table, key, tp), value);
-        tiny_ptr_free(table, key, tp);
-    }
-    tiny_ptr_destroy(table);
-}
-
-// Test 6: Multi-threaded operations.
-TEST(TinyPtrSimple, MultiThreaded) {
-    size_t capacity = 10000;
-    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SIMPLE, 0.9);
-    ASSERT_NE(table, nullptr);
-    const int num_threads = 4, allocs_per_thread = 1000;
-    std::vector<std::thread> threads;
-    std::atomic<int> failures(0);
-    auto threadFunc = [table, allocs_per_thread, &failures](int start_key) {
-        for (int i = 0; i < allocs_per_thread; i++) {
-            int key = start_key + i;
-            int value = key * 10;
-            int tp = tiny_ptr_allocate(table, key, value);
-            if (tp == -1) { failures++; continue; }
-            if (tiny_ptr_dereference(table, key, tp) != value) { failures++; }
-            tiny_ptr_free(table, key, tp);
-        }
-    };
-    for (int i = 0; i < num_threads; i++) {
-        threads.emplace_back(threadFunc, i * allocs_per_thread);
-    }
-    for (auto& t : threads) { t.join(); }
-    EXPECT_EQ(failures.load(), 0);
-    tiny_ptr_destroy(table);
-}
-
-// Test 7: Reallocation after free.
-TEST(TinyPtrSimple, ReallocateAfterFree) {
-    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
-    ASSERT_NE(table, nullptr);
-    int key = 3000, value1 = 111, value2 = 222;
-    int tp = tiny_ptr_allocate(table, key, value1);
-    ASSERT_NE(tp, -1);
-    EXPECT_EQ(tiny_ptr_dereference(table, key, tp), value1);
-    tiny_ptr_free(table, key, tp);
-    int tp_new = tiny_ptr_allocate(table, key, value2);
-    EXPECT_NE(tp_new, -1);
-    EXPECT_EQ(tiny_ptr_dereference(table, key, tp_new), value2);
-    tiny_ptr_destroy(table);
-}
-
-// Test 8: Double free should not crash.
-TEST(TinyPtrSimple, DoubleFree) {
-    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
-    ASSERT_NE(table, nullptr);
-    int key = 4000, value = 999;
-    int tp = tiny_ptr_allocate(table, key, value);
-    ASSERT_NE(tp, -1);
-    tiny_ptr_free(table, key, tp);
-    // Second free; while undefined behavior, ensure no crash.
-    tiny_ptr_free(table, key, tp);
-    tiny_ptr_destroy(table);
-}
-
-int main(int argc, char** argv) {
-    ::testing::InitGoogleTest(&argc, argv);
-    return RUN_ALL_TESTS();
-}
+extern "C" {
+    #include "tiny_ptr_unified.h"
+    #include "tiny_ptr_frozen.h"
+    #include "tiny_ptr_simple.h"
+}
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Test 1: Operations on a NULL table.
+TEST(TinyPtrSimple, NullTableOperations) {
+    EXPECT_EQ(tiny_ptr_allocate(nullptr, 123, 456), -1);
+    EXPECT_EQ(tiny_ptr_dereference(nullptr, 123, 0), -1);
+    // tiny_ptr_free is void; calling it on a null table should not crash.
+    tiny_ptr_free(nullptr, 123, 0);
+}
+
+// Test 2: Basic allocation, dereference and free.
+TEST(TinyPtrSimple, BasicAllocation) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    for (int i = 0; i < 100; i++) {
+        int key = i + 1000;
+        int value = key * 10;
+        int tp = tiny_ptr_allocate(table, key, value);
+        EXPECT_NE(tp, -1) << "Allocation failed for key " << key;
+        int ret = tiny_ptr_dereference(table, key, tp);
+        EXPECT_EQ(ret, value) << "Dereference mismatch for key " << key;
+        tiny_ptr_free(table, key, tp);
+        ret = tiny_ptr_dereference(table, key, tp);
+        EXPECT_EQ(ret, 0) << "Slot not reset after free for key " << key;
+    }
+    tiny_ptr_destroy(table);
+}
+
+// Test 3: Multiple allocations with the same key.
+TEST(TinyPtrSimple, MultipleAllocationsSameKey) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    int key = 5000;
+    int value1 = 123, value2 = 456;
+    int tp1 = tiny_ptr_allocate(table, key, value1);
+    EXPECT_NE(tp1, -1);
+    int tp2 = tiny_ptr_allocate(table, key, value2);
+    EXPECT_NE(tp2, -1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp1), value1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp2), value2);
+    tiny_ptr_free(table, key, tp1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp1), 0);
+    tiny_ptr_free(table, key, tp2);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp2), 0);
+    tiny_ptr_destroy(table);
+}
+
+// Test 4: Allocate until full and then free.
+TEST(TinyPtrSimple, AllocateUntilFull) {
+    size_t capacity = 64; // small capacity to force failure quickly
+    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    std::vector<int> allocated;
+    int key = 1000, value = 10;
+    while (true) {
+        int tp = tiny_ptr_allocate(table, key, value);
+        if (tp == -1) break;
+        allocated.push_back(tp);
+        key++;
+        value += 10;
+    }
+    EXPECT_GT(allocated.size(), 0u);
+    key = 1000;
+    for (int tp : allocated) {
+        tiny_ptr_free(table, key, tp);
+        key++;
+    }
+    int new_tp = tiny_ptr_allocate(table, 9999, 99990);
+    EXPECT_NE(new_tp, -1);
+    tiny_ptr_destroy(table);
+}
+
+// Test 5: Resize test (SIMPLE variant only).
+TEST(TinyPtrSimple, ResizeTest) {
+    size_t capacity = 128;
+    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    int half = capacity / 2;
+    for (int i = 0; i < half; i++) {
+        int key = i + 2000;
+        int value = key * 10;
+        int tp = tiny_ptr_allocate(table, key, value);
+        EXPECT_NE(tp, -1);
+    }
+    EXPECT_EQ(tiny_ptr_resize(&table, capacity * 2), 0);
+    for (int i = half; i < (int)capacity; i++) {
+        int key = i + 2000;
+        int value = key * 10;
+        int tp = tiny_ptr_allocate(table, key, value);
+        EXPECT_NE(tp, -1);
+        EXPECT_EQ(tiny_ptr_dereference(table, key, tp), value);
+        tiny_ptr_free(table, key, tp);
+    }
+    tiny_ptr_destroy(table);
+}
+
+// Test 6: Multi-threaded operations.
+TEST(TinyPtrSimple, MultiThreaded) {
+    size_t capacity = 10000;
+    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    const int num_threads = 4, allocs_per_thread = 1000;
+    std::vector<std::thread> threads;
+    std::atomic<int> failures(0);
+    auto threadFunc = [table, allocs_per_thread, &failures](int start_key) {
+        for (int i = 0; i < allocs_per_thread; i++) {
+            int key = start_key + i;
+            int value = key * 10;
+            int tp = tiny_ptr_allocate(table, key, value);
+            if (tp == -1) { failures++; continue; }
+            if (tiny_ptr_dereference(table, key, tp) != value) { failures++; }
+            tiny_ptr_free(table, key, tp);
+        }
+    };
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(threadFunc, i * allocs_per_thread);
+    }
+    for (auto& t : threads) { t.join(); }
+    EXPECT_EQ(failures.load(), 0);
+    tiny_ptr_destroy(table);
+}
+
+// Test 7: Reallocation after free.
+TEST(TinyPtrSimple, ReallocateAfterFree) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    int key = 3000, value1 = 111, value2 = 222;
+    int tp = tiny_ptr_allocate(table, key, value1);
+    ASSERT_NE(tp, -1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp), value1);
+    tiny_ptr_free(table, key, tp);
+    int tp_new = tiny_ptr_allocate(table, key, value2);
+    EXPECT_NE(tp_new, -1);
+    EXPECT_EQ(tiny_ptr_dereference(table, key, tp_new), value2);
+    tiny_ptr_destroy(table);
+}
+
+// Test 8: Double free should not crash.
+TEST(TinyPtrSimple, DoubleFree) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    int key = 4000, value = 999;
+    int tp = tiny_ptr_allocate(table, key, value);
+    ASSERT_NE(tp, -1);
+    tiny_ptr_free(table, key, tp);
+    // Second free; while undefined behavior, ensure no crash.
+    tiny_ptr_free(table, key, tp);
+    tiny_ptr_destroy(table);
+}
+
+// Test 9: Dereferences keep running while the table is resized underneath them.
+TEST(TinyPtrSimple, ResizeWithConcurrentReaders) {
+    size_t capacity = 1024;
+    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    // Every value is its own key, so a read of any other value is memory that was not ours.
+    for (int i = 0; i < 256; i++) {
+        ASSERT_NE(tiny_ptr_allocate(table, i + 7000, i + 7000), -1);
+    }
+    std::atomic<bool> stop(false);
+    std::atomic<long> reads(0);
+    std::atomic<long> bad_reads(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([table, t, &stop, &reads, &bad_reads]() {
+            int key = 7000 + t;
+            while (!stop.load()) {
+                int value = tiny_ptr_dereference(table, key, 0);
+                if (value != 0 && (value < 7000 || value >= 7256)) bad_reads++;
+                reads++;
+            }
+        });
+    }
+    while (reads.load() == 0) { std::this_thread::yield(); }
+    for (int round = 0; round < 50; round++) {
+        size_t new_capacity = (round % 2 == 0) ? capacity * 4 : capacity * 2;
+        EXPECT_EQ(tiny_ptr_resize(&table, new_capacity), 0);
+    }
+    stop = true;
+    for (auto& t : readers) { t.join(); }
+    EXPECT_GT(reads.load(), 0);
+    EXPECT_EQ(bad_reads.load(), 0);
+    for (int i = 0; i < 256; i++) {
+        int tps[8];
+        ASSERT_EQ(tiny_ptr_find(table, i + 7000, tps, 8), 1u);
+        EXPECT_EQ(tiny_ptr_dereference(table, i + 7000, tps[0]), i + 7000);
+    }
+    tiny_ptr_destroy(table);
+}
+
+// Test 10: Parallel resize keeps every entry reachable under its key.
+TEST(TinyPtrSimple, ParallelResize) {
+    size_t capacity = 4096;
+    tiny_ptr_table_t* table = tiny_ptr_create(capacity, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    const int count = 2000;
+    for (int i = 0; i < count; i++) {
+        ASSERT_NE(tiny_ptr_allocate(table, i + 9000, i * 3 + 1), -1);
+    }
+    EXPECT_EQ(tiny_ptr_resize_parallel(&table, capacity * 4, 4), 0);
+    // Tiny pointers change with the geometry; probe the 8 slots of each key's bucket.
+    int found = 0;
+    for (int i = 0; i < count; i++) {
+        for (int tp = 0; tp < 8; tp++) {
+            if (tiny_ptr_dereference(table, i + 9000, tp) == i * 3 + 1) { found++; break; }
+        }
+    }
+    EXPECT_EQ(found, count);
+    tiny_ptr_destroy(table);
+}
+
+// Test 11: 64-slot buckets hold more entries before the first overflow than 32-slot ones.
+TEST(TinyPtrSimple, WideBuckets) {
+    auto fill_until_overflow = [](size_t bucket_size, int* max_tp) {
+        SimpleTable* st = simple_create_sized(4096, 1.0, bucket_size);
+        EXPECT_NE(st, nullptr);
+        int count = 0;
+        for (int k = 0;; k++) {
+            int tp = simple_allocate(st, k * 7 + 1, k);
+            if (tp == -1) break;
+            EXPECT_EQ(simple_dereference(st, k * 7 + 1, tp), k);
+            if (tp > *max_tp) *max_tp = tp;
+            count++;
+        }
+        EXPECT_EQ(simple_live_count(st), (size_t)count);
+        simple_destroy(st);
+        return count;
+    };
+    int max_tp32 = 0, max_tp64 = 0;
+    int filled32 = fill_until_overflow(32, &max_tp32);
+    int filled64 = fill_until_overflow(64, &max_tp64);
+    EXPECT_GT(filled64, filled32);
+    EXPECT_LE(max_tp32, 31);
+    EXPECT_GT(max_tp64, 31);
+    EXPECT_LE(max_tp64, 63);
+    EXPECT_EQ(simple_create_sized(4096, 1.0, 65), nullptr);
+}
+
+// Test 12: Walking a sparse table visits exactly the live entries.
+TEST(TinyPtrSimple, SparseVisit) {
+    SimpleTable* st = simple_create(1 << 16);
+    ASSERT_NE(st, nullptr);
+    for (int i = 0; i < 10; i++) {
+        ASSERT_NE(simple_allocate(st, i * 977, i), -1);
+    }
+    int visited = 0;
+    simple_visit(st, [](void* ctx, int key, int value, int) {
+        EXPECT_EQ(key, value * 977);
+        (*static_cast<int*>(ctx))++;
+    }, &visited);
+    EXPECT_EQ(visited, 10);
+    EXPECT_EQ(simple_live_count(st), 10u);
+    simple_destroy(st);
+}
+
+// Resident set size of this process in bytes.
+static long resident_bytes() {
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * 4096;
+}
+
+// Test 13: Creating a huge table commits almost no memory until entries are written.
+TEST(TinyPtrSimple, LazyCreation) {
+    long before = resident_bytes();
+    SimpleTable* st = simple_create(1 << 26);
+    ASSERT_NE(st, nullptr);
+    EXPECT_LT(resident_bytes() - before, 16L << 20);
+    EXPECT_EQ(simple_live_count(st), 0u);
+    for (int i = 0; i < 1000; i++) {
+        int tp = simple_allocate(st, i * 31, i + 5);
+        ASSERT_NE(tp, -1);
+        EXPECT_EQ(simple_dereference(st, i * 31, tp), i + 5);
+    }
+    EXPECT_EQ(simple_live_count(st), 1000u);
+    simple_destroy(st);
+}
+
+// Test 14: A table in shared memory is read and written by a forked process that attaches to it.
+TEST(TinyPtrSimple, SharedAcrossProcesses) {
+    std::string name = "/tiny_ptr_test_" + std::to_string(getpid());
+    tiny_ptr_table_t* table = tiny_ptr_create_shared(name.c_str(), 4096, 0.9);
+    ASSERT_NE(table, nullptr);
+    const int n = 1000;
+    std::vector<int> parent_tps(n);
+    for (int i = 0; i < n; i++) {
+        parent_tps[i] = tiny_ptr_allocate(table, i + 41000, i + 1);
+        ASSERT_NE(parent_tps[i], -1);
+    }
+    // The child reports its tiny pointers through an anonymous shared mapping.
+    int* child_tps = static_cast<int*>(mmap(nullptr, n * sizeof(int), PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+    ASSERT_NE(child_tps, MAP_FAILED);
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        tiny_ptr_table_t* attached = tiny_ptr_attach_shared(name.c_str());
+        int ok = attached != nullptr;
+        for (int i = 0; ok && i < n; i++) {
+            ok = tiny_ptr_dereference(attached, i + 41000, parent_tps[i]) == i + 1;
+            child_tps[i] = tiny_ptr_allocate(attached, i + 51000, -(i + 1));
+            ok = ok && child_tps[i] != -1;
+        }
+        tiny_ptr_destroy(attached);
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    for (int i = 0; i < n; i++) {
+        EXPECT_EQ(tiny_ptr_dereference(table, i + 51000, child_tps[i]), -(i + 1)) << "Mismatch for key " << i + 51000;
+    }
+    EXPECT_EQ(tiny_ptr_resize(&table, 8192), -1);
+    munmap(child_tps, n * sizeof(int));
+    tiny_ptr_destroy(table);
+    simple_unlink_shared(name.c_str());
+}
+
+// Test 15: Batch dereference through the dispatched kernel matches single dereferences.
+TEST(TinyPtrSimple, DispatchedBatchDereference) {
+    TinyPtrSimdLevel level = tiny_ptr_simd_level();
+    EXPECT_GE(level, TINY_PTR_SIMD_GENERIC);
+    EXPECT_LE(level, TINY_PTR_SIMD_AVX512);
+    EXPECT_NE(simple_simd_level_name(level), nullptr);
+    tiny_ptr_table_t* table = tiny_ptr_create(4096, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    std::vector<int> keys, tps;
+    for (int i = 0; i < 3000; i++) {
+        int tp = tiny_ptr_allocate(table, i + 61000, 5 * i);
+        if (tp != -1) {
+            keys.push_back(i + 61000);
+            tps.push_back(tp);
+        }
+    }
+    std::vector<int> out(keys.size(), -1);
+    ASSERT_EQ(tiny_ptr_dereference_batch(table, keys.data(), tps.data(), keys.size(), out.data()), 0);
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(out[i], 5 * (keys[i] - 61000)) << "Mismatch for key " << keys[i];
+        EXPECT_EQ(out[i], tiny_ptr_dereference(table, keys[i], tps[i]));
+    }
+    EXPECT_EQ(tiny_ptr_dereference_batch(nullptr, keys.data(), tps.data(), keys.size(), out.data()), -1);
+    tiny_ptr_destroy(table);
+}
+
+// Test 16: Entries live for a whole scan are reported once while another thread allocates and frees.
+TEST(TinyPtrSimple, CursorUnderChurn) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1 << 14, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    const int stable = 5000;
+    for (int i = 0; i < stable; i++) {
+        ASSERT_NE(tiny_ptr_allocate(table, i, i * 2), -1);
+    }
+    std::atomic<bool> stop{false};
+    std::thread churn([&] {
+        for (int round = 0; !stop.load(); round++) {
+            int key = 1000000 + round % 4096;
+            int tp = tiny_ptr_allocate(table, key, key - 1000000);
+            if (tp != -1) tiny_ptr_free(table, key, tp);
+        }
+    });
+    for (int scan = 0; scan < 20; scan++) {
+        std::vector<int> count(stable, 0);
+        TinyPtrCursor cur;
+        ASSERT_EQ(tiny_ptr_cursor_open(table, &cur, 0, 1), 0);
+        int key, value, tp;
+        while (tiny_ptr_cursor_next(&cur, &key, &value, &tp)) {
+            if (key >= 1000000) {
+                EXPECT_EQ(value, key - 1000000);
+                continue;
+            }
+            ASSERT_GE(key, 0);
+            ASSERT_LT(key, stable);
+            EXPECT_EQ(value, key * 2);
+            count[key]++;
+        }
+        tiny_ptr_cursor_close(&cur);
+        EXPECT_EQ(std::count(count.begin(), count.end(), 1), stable);
+    }
+    stop = true;
+    churn.join();
+    tiny_ptr_destroy(table);
+}
+
+// Test 17: A mask-only table claims and releases slots without key or value arrays.
+TEST(TinyPtrSimple, MaskOnlyClaims) {
+    SimpleTable* masks = simple_create_mask_only(1024, 0.9);
+    SimpleTable* full = simple_create_ex(1024, 0.9);
+    ASSERT_NE(masks, nullptr);
+    ASSERT_NE(full, nullptr);
+    SimpleGeometry g;
+    ASSERT_EQ(simple_geometry(masks, &g), 0);
+    EXPECT_EQ(simple_memory_usage(full) - simple_memory_usage(masks), g.bucket_count * g.bucket_size * 2 * sizeof(int));
+    std::vector<int> tps;
+    int tp;
+    while ((tp = simple_claim_slot(masks, 11)) != -1) tps.push_back(tp);
+    EXPECT_EQ(tps.size(), g.bucket_size);
+    EXPECT_EQ(simple_live_count(masks), g.bucket_size);
+    simple_release_slot(masks, 11, tps[2]);
+    simple_release_slot(masks, 11, (int)g.bucket_size);
+    EXPECT_EQ(simple_live_count(masks), g.bucket_size - 1);
+    EXPECT_EQ(simple_claim_slot(masks, 11), tps[2]);
+    simple_destroy(masks);
+    simple_destroy(full);
+}
+
+// Test 18: Resize and compact fail while a cursor is open, and the cursor can be closed from another thread.
+TEST(TinyPtrSimple, CursorBlocksResize) {
+    tiny_ptr_table_t* table = tiny_ptr_create(1024, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_NE(tiny_ptr_allocate(table, i, i), -1);
+    }
+    TinyPtrCursor cur;
+    ASSERT_EQ(tiny_ptr_cursor_open(table, &cur, 0, 1), 0);
+    int key, value, tp;
+    ASSERT_EQ(tiny_ptr_cursor_next(&cur, &key, &value, &tp), 1);
+    EXPECT_EQ(tiny_ptr_resize(&table, 4096), -1);
+    EXPECT_EQ(tiny_ptr_compact(table, nullptr, nullptr), -1);
+    // Writers are not held off by the cursor.
+    int extra = tiny_ptr_allocate(table, 5000, 1);
+    EXPECT_NE(extra, -1);
+    std::thread closer([&] { tiny_ptr_cursor_close(&cur); });
+    closer.join();
+    tiny_ptr_cursor_close(&cur);
+    EXPECT_EQ(tiny_ptr_resize(&table, 4096), 0);
+    tiny_ptr_destroy(table);
+}
+
+// Test 19: A frozen image takes about a bit per slot for occupancy, and opening one rejects truncated or corrupt copies.
+TEST(TinyPtrSimple, FrozenImageValidated) {
+    tiny_ptr_table_t* table = tiny_ptr_create(4096, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    std::map<int, int> tps;
+    for (int i = 0; i < 2000; i++) {
+        int tp = tiny_ptr_allocate(table, i + 31000, 3 * i + 7);
+        if (tp != -1) tps[i + 31000] = tp;
+    }
+    tiny_ptr_frozen_t* frozen = tiny_ptr_freeze(table);
+    ASSERT_NE(frozen, nullptr);
+    tiny_ptr_destroy(table);
+    size_t size = 0;
+    const void* data = tiny_ptr_frozen_data(frozen, &size);
+    // 8192 slots of occupancy plus 2000 values of 13 bits each
+    EXPECT_LT(size, 5000u);
+    std::vector<uint64_t> good((size + 7) / 8);
+    memcpy(good.data(), data, size);
+    tiny_ptr_frozen_destroy(frozen);
+    // Byte offsets: total_size in the outer header, then bucket_count, value_bits, live and occupancy in the table image
+    const size_t total_size = 16, bucket_count = 32, value_bits = 40, live = 48, used = 56;
+    auto opens = [&](std::vector<uint64_t> bytes, size_t length) {
+        tiny_ptr_frozen_t* f = tiny_ptr_frozen_open(bytes.data(), length);
+        bool ok = f != nullptr;
+        for (auto& kv : tps) {
+            if (ok && tiny_ptr_frozen_dereference(f, kv.first, kv.second) != 3 * (kv.first - 31000) + 7) ok = false;
+        }
+        tiny_ptr_frozen_destroy(f);
+        return ok;
+    };
+    auto patch = [&](size_t offset, uint64_t value, size_t width) {
+        std::vector<uint64_t> bytes = good;
+        memcpy(reinterpret_cast<char*>(bytes.data()) + offset, &value, width);
+        return bytes;
+    };
+    auto field = [&](size_t offset, size_t width) {
+        uint64_t value = 0;
+        memcpy(&value, reinterpret_cast<const char*>(good.data()) + offset, width);
+        return value;
+    };
+    EXPECT_TRUE(opens(good, size));
+    EXPECT_FALSE(opens(good, size - 8));
+    EXPECT_FALSE(opens(patch(total_size, size - 8, 8), size - 8));
+    EXPECT_FALSE(opens(patch(bucket_count, field(bucket_count, 8) * 2, 8), size));
+    EXPECT_FALSE(opens(patch(bucket_count, 3, 8), size));
+    EXPECT_FALSE(opens(patch(value_bits, 40, 4), size));
+    EXPECT_FALSE(opens(patch(live, field(live, 8) + 1, 8), size));
+    EXPECT_FALSE(opens(patch(used, field(used, 8) ^ 1, 8), size));
+    EXPECT_EQ(tiny_ptr_frozen_open(reinterpret_cast<const char*>(good.data()) + 1, size), nullptr);
+    std::string path = ::testing::TempDir() + "tiny_ptr_frozen_truncated.bin";
+    std::vector<uint64_t> cut = patch(total_size, size - 8, 8);
+    FILE* f = fopen(path.c_str(), "wb");
+    ASSERT_NE(f, nullptr);
+    ASSERT_EQ(fwrite(cut.data(), 1, size - 8, f), size - 8);
+    fclose(f);
+    EXPECT_EQ(tiny_ptr_frozen_load(path.c_str()), nullptr);
+    std::remove(path.c_str());
+}
+
+// Test 20: Batch dereferences and finds read stable entries correctly while writers churn the table.
+TEST(TinyPtrSimple, LockFreeReadsDuringWrites) {
+    tiny_ptr_table_t* table = tiny_ptr_create(4096, TINY_PTR_SIMPLE, 0.9);
+    ASSERT_NE(table, nullptr);
+    std::vector<int> keys, tps;
+    for (int i = 0; i < 512; i++) {
+        int tp = tiny_ptr_allocate(table, i + 61000, i + 61000);
+        ASSERT_NE(tp, -1);
+        keys.push_back(i + 61000);
+        tps.push_back(tp);
+    }
+    std::atomic<bool> stop(false);
+    std::thread writer([&]() {
+        std::vector<int> churn;
+        for (int round = 0; !stop.load(); round++) {
+            for (int i = 0; i < 256; i++) churn.push_back(tiny_ptr_allocate(table, i + 62000, round));
+            for (int i = 0; i < 256; i++) tiny_ptr_free(table, i + 62000, churn[i]);
+            churn.clear();
+        }
+    });
+    long bad = 0;
+    std::vector<int> out(keys.size());
+    for (int pass = 0; pass < 200; pass++) {
+        ASSERT_EQ(tiny_ptr_dereference_batch(table, keys.data(), tps.data(), keys.size(), out.data()), 0);
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (out[i] != keys[i]) bad++;
+            int found[8];
+            size_t count = tiny_ptr_find(table, keys[i], found, 8);
+            if (count != 1 || found[0] != tps[i]) bad++;
+        }
+    }
+    stop = true;
+    writer.join();
+    EXPECT_EQ(bad, 0);
+    tiny_ptr_destroy(table);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
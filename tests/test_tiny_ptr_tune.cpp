@@ -0,0 +1,148 @@
+extern "C" {
+    #include "tiny_ptr_tune.h"
+    #include "tiny_ptr_fixed.h"
+    #include "tiny_ptr_sharded.h"
+}
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+
+static std::vector<int> random_keys(size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> keys(n);
+    for (auto& k : keys) k = (int)rng();
+    return keys;
+}
+
+/* Allocate every key into a table built from config; returns the failures */
+static size_t failures_with(const TinyPtrConfig& config, const std::vector<int>& keys) {
+    tiny_ptr_table_t* table = tiny_ptr_create_config(&config);
+    EXPECT_NE(table, nullptr);
+    if (!table) return keys.size();
+    size_t failures = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (tiny_ptr_allocate(table, keys[i], (int)i) == -1) failures++;
+    }
+    tiny_ptr_destroy(table);
+    return failures;
+}
+
+// Test 1: Invalid arguments and invalid configurations are rejected.
+TEST(TinyPtrTune, InvalidArguments) {
+    TinyPtrConfig config;
+    int key = 1;
+    EXPECT_EQ(tiny_ptr_tune(TINY_PTR_SIMPLE, nullptr, 10, 0.0, &config, nullptr), -1);
+    EXPECT_EQ(tiny_ptr_tune(TINY_PTR_SIMPLE, &key, 0, 0.0, &config, nullptr), -1);
+    EXPECT_EQ(tiny_ptr_tune(TINY_PTR_SIMPLE, &key, 1, -1.0, &config, nullptr), -1);
+    EXPECT_EQ(tiny_ptr_tune(TINY_PTR_SIMPLE, &key, 1, 0.0, nullptr, nullptr), -1);
+    TinyPtrOp orphan_free = {5, 1};
+    EXPECT_EQ(tiny_ptr_tune_workload(TINY_PTR_SIMPLE, &orphan_free, 1, 0.0, &config, nullptr), -1);
+    EXPECT_EQ(fixed_create_ex(1024, 0.9, 0.0), nullptr);
+    EXPECT_EQ(fixed_create_ex(1024, 0.9, 1.0), nullptr);
+    ASSERT_EQ(tiny_ptr_default_config(1024, TINY_PTR_VARIABLE, 0.9, &config), 0);
+    config.level_count = 17;
+    EXPECT_EQ(tiny_ptr_create_config(&config), nullptr);
+}
+
+// Test 2: The default configuration reproduces tiny_ptr_create.
+TEST(TinyPtrTune, DefaultConfigMatchesCreate) {
+    TinyPtrVariant variants[] = {TINY_PTR_SIMPLE, TINY_PTR_FIXED, TINY_PTR_VARIABLE};
+    for (TinyPtrVariant variant : variants) {
+        TinyPtrConfig config;
+        ASSERT_EQ(tiny_ptr_default_config(4096, variant, 0.9, &config), 0);
+        tiny_ptr_table_t* a = tiny_ptr_create(4096, variant, 0.9);
+        tiny_ptr_table_t* b = tiny_ptr_create_config(&config);
+        ASSERT_NE(a, nullptr);
+        ASSERT_NE(b, nullptr);
+        EXPECT_EQ(tiny_ptr_memory_usage(a), tiny_ptr_memory_usage(b));
+        tiny_ptr_destroy(a);
+        tiny_ptr_destroy(b);
+    }
+}
+
+// Test 3: A tuned SIMPLE table holds the sample without failures, and a looser target never costs more memory.
+TEST(TinyPtrTune, SimpleMeetsTarget) {
+    std::vector<int> keys = random_keys(20000, 1);
+    TinyPtrConfig strict, loose;
+    TinyPtrTuneReport strict_report, loose_report;
+    ASSERT_EQ(tiny_ptr_tune(TINY_PTR_SIMPLE, keys.data(), keys.size(), 0.0, &strict, &strict_report), 0);
+    EXPECT_EQ(strict.variant, TINY_PTR_SIMPLE);
+    EXPECT_EQ(strict.capacity, keys.size());
+    EXPECT_EQ(strict_report.allocations, keys.size());
+    EXPECT_EQ(strict_report.failures, 0u);
+    EXPECT_EQ(failures_with(strict, keys), 0u);
+    ASSERT_EQ(tiny_ptr_tune(TINY_PTR_SIMPLE, keys.data(), keys.size(), 0.05, &loose, &loose_report), 0);
+    EXPECT_LE(loose_report.memory_bytes, strict_report.memory_bytes);
+    EXPECT_LE(loose_report.failures, keys.size() / 20);
+}
+
+// Test 4: FIXED and VARIABLE tables are tuned over their own parameters.
+TEST(TinyPtrTune, FixedAndVariable) {
+    std::vector<int> keys = random_keys(10000, 2);
+    TinyPtrConfig config;
+    TinyPtrTuneReport report;
+    ASSERT_EQ(tiny_ptr_tune(TINY_PTR_FIXED, keys.data(), keys.size(), 0.0, &config, &report), 0);
+    EXPECT_GT(config.primary_fraction, 0.0);
+    EXPECT_LT(config.primary_fraction, 1.0);
+    EXPECT_EQ(failures_with(config, keys), 0u);
+    ASSERT_EQ(tiny_ptr_tune(TINY_PTR_VARIABLE, keys.data(), keys.size(), 0.0, &config, &report), 0);
+    EXPECT_GE(config.level_count, 1u);
+    EXPECT_LE(config.level_count, 16u);
+    EXPECT_EQ(failures_with(config, keys), 0u);
+    EXPECT_GT(report.candidates, 0u);
+}
+
+// Test 5: A workload with frees is sized for its peak live count.
+TEST(TinyPtrTune, WorkloadWithFrees) {
+    std::vector<int> keys = random_keys(4000, 3);
+    std::vector<TinyPtrOp> ops;
+    // Keep at most 1000 entries live: each allocation past that frees the oldest key.
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (i >= 1000) ops.push_back({keys[i - 1000], 1});
+        ops.push_back({keys[i], 0});
+    }
+    TinyPtrConfig config;
+    TinyPtrTuneReport report;
+    ASSERT_EQ(tiny_ptr_tune_workload(TINY_PTR_SIMPLE, ops.data(), ops.size(), 0.0, &config, &report), 0);
+    EXPECT_EQ(config.capacity, 1000u);
+    EXPECT_EQ(report.allocations, keys.size());
+    EXPECT_EQ(report.failures, 0u);
+}
+
+// Test 6: Frees pair with the latest live allocation of their key, and one free too many is rejected.
+TEST(TinyPtrTune, FreesPairPerKey) {
+    std::vector<TinyPtrOp> ops = {{7, 0}, {8, 0}, {7, 0}, {7, 1}, {8, 1}, {7, 1}, {9, 0}};
+    TinyPtrConfig config;
+    TinyPtrTuneReport report;
+    ASSERT_EQ(tiny_ptr_tune_workload(TINY_PTR_SIMPLE, ops.data(), ops.size(), 0.0, &config, &report), 0);
+    EXPECT_EQ(config.capacity, 3u);
+    EXPECT_EQ(report.allocations, 4u);
+    ops.push_back({7, 1});
+    EXPECT_EQ(tiny_ptr_tune_workload(TINY_PTR_SIMPLE, ops.data(), ops.size(), 0.0, &config, &report), -1);
+}
+
+// Test 7: SHARDED configurations honour shard_count, and the tuner records the count it simulated.
+TEST(TinyPtrTune, ShardCount) {
+    TinyPtrConfig config;
+    ASSERT_EQ(tiny_ptr_default_config(4096, TINY_PTR_SHARDED, 0.9, &config), 0);
+    EXPECT_EQ(config.shard_count, 0u);
+    config.shard_count = 2;
+    tiny_ptr_table_t* two = tiny_ptr_create_config(&config);
+    config.shard_count = 16;
+    tiny_ptr_table_t* sixteen = tiny_ptr_create_config(&config);
+    ASSERT_NE(two, nullptr);
+    ASSERT_NE(sixteen, nullptr);
+    EXPECT_LT(tiny_ptr_memory_usage(two), tiny_ptr_memory_usage(sixteen));
+    tiny_ptr_destroy(two);
+    tiny_ptr_destroy(sixteen);
+    std::vector<int> keys = random_keys(10000, 4);
+    TinyPtrTuneReport report;
+    ASSERT_EQ(tiny_ptr_tune(TINY_PTR_SHARDED, keys.data(), keys.size(), 0.05, &config, &report), 0);
+    EXPECT_EQ(config.shard_count, sharded_default_shard_count());
+    EXPECT_EQ(failures_with(config, keys), report.failures);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,198 @@
+extern "C" {
+    #include "tiny_ptr_unified.h"
+    #include "tiny_ptr_frozen.h"
+}
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <array>
+#include <map>
+#include <algorithm>
+#include <string>
+#include <cstdio>
+
+/*
+ * Behaviour shared by every variant through the unified interface. Each test
+ * runs once per TinyPtrVariant; behaviour that differs between variants stays
+ * in the per-variant test files.
+ */
+class TinyPtrVariants : public ::testing::TestWithParam<TinyPtrVariant> {};
+
+static std::string variant_name(const ::testing::TestParamInfo<TinyPtrVariant>& info) {
+    switch (info.param) {
+    case TINY_PTR_SIMPLE: return "Simple";
+    case TINY_PTR_FIXED: return "Fixed";
+    case TINY_PTR_VARIABLE: return "Variable";
+    case TINY_PTR_SHARDED: return "Sharded";
+    }
+    return "Unknown";
+}
+
+// Test 1: Bulk build places every pair and returns usable tiny pointers.
+TEST_P(TinyPtrVariants, BulkBuild) {
+    const int count = 5000;
+    std::vector<int> keys(count), values(count), tps(count);
+    for (int i = 0; i < count; i++) {
+        keys[i] = i + 11000;
+        values[i] = i * 7 + 1;
+    }
+    tiny_ptr_table_t* table = tiny_ptr_bulk_build(GetParam(), keys.data(), values.data(), count, tps.data(), 4);
+    ASSERT_NE(table, nullptr);
+    for (int i = 0; i < count; i++) {
+        ASSERT_NE(tps[i], -1);
+        EXPECT_EQ(tiny_ptr_dereference(table, keys[i], tps[i]), values[i]) << "Mismatch for key " << keys[i];
+    }
+    // Placement is stable, so a single-threaded build yields the same tiny pointers.
+    std::vector<int> serial_tps(count);
+    tiny_ptr_table_t* serial = tiny_ptr_bulk_build(GetParam(), keys.data(), values.data(), count, serial_tps.data(), 1);
+    ASSERT_NE(serial, nullptr);
+    EXPECT_EQ(serial_tps, tps);
+    tiny_ptr_destroy(serial);
+    tiny_ptr_free(table, keys[0], tps[0]);
+    EXPECT_EQ(tiny_ptr_dereference(table, keys[0], tps[0]), 0);
+    tiny_ptr_destroy(table);
+}
+
+// Test 2: Compaction after a mass free keeps survivors reachable via remapped tiny pointers.
+TEST_P(TinyPtrVariants, CompactAfterMassFree) {
+    tiny_ptr_table_t* table = tiny_ptr_create(8192, GetParam(), 0.9);
+    ASSERT_NE(table, nullptr);
+    std::map<int, int> tps;
+    for (int i = 0; i < 4000; i++) {
+        int tp = tiny_ptr_allocate(table, i + 20000, i + 1);
+        if (tp != -1) tps[i + 20000] = tp;
+    }
+    for (auto it = tps.begin(); it != tps.end();) {
+        if ((it->first - 20000) % 10 != 0) {
+            tiny_ptr_free(table, it->first, it->second);
+            it = tps.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    auto remap = [](void* ctx, int key, int old_tp, int new_tp) {
+        auto* m = static_cast<std::map<int, int>*>(ctx);
+        EXPECT_EQ((*m)[key], old_tp);
+        (*m)[key] = new_tp;
+    };
+    EXPECT_EQ(tiny_ptr_compact(table, remap, &tps), 0);
+    for (auto& kv : tps) {
+        EXPECT_EQ(tiny_ptr_dereference(table, kv.first, kv.second), kv.first - 20000 + 1) << "Mismatch for key " << kv.first;
+    }
+    EXPECT_NE(tiny_ptr_allocate(table, 20000 - 1, 42), -1);
+    tiny_ptr_destroy(table);
+}
+
+// Test 3: A frozen copy answers every tiny pointer, also after a save and reload from disk.
+TEST_P(TinyPtrVariants, FreezeTable) {
+    tiny_ptr_table_t* table = tiny_ptr_create(4096, GetParam(), 0.9);
+    ASSERT_NE(table, nullptr);
+    std::map<int, int> tps;
+    for (int i = 0; i < 2000; i++) {
+        int tp = tiny_ptr_allocate(table, i + 31000, 3 * i + 7);
+        if (tp != -1) tps[i + 31000] = tp;
+    }
+    auto freed = *tps.begin();
+    tiny_ptr_free(table, freed.first, freed.second);
+    tps.erase(tps.begin());
+    tiny_ptr_frozen_t* frozen = tiny_ptr_freeze(table);
+    ASSERT_NE(frozen, nullptr);
+    tiny_ptr_destroy(table);
+    for (auto& kv : tps) {
+        EXPECT_EQ(tiny_ptr_frozen_dereference(frozen, kv.first, kv.second), 3 * (kv.first - 31000) + 7) << "Mismatch for key " << kv.first;
+    }
+    EXPECT_EQ(tiny_ptr_frozen_dereference(frozen, freed.first, freed.second), 0);
+    std::string path = ::testing::TempDir() + "tiny_ptr_frozen_" + std::to_string(GetParam()) + ".bin";
+    ASSERT_EQ(tiny_ptr_frozen_save(frozen, path.c_str()), 0);
+    tiny_ptr_frozen_destroy(frozen);
+    tiny_ptr_frozen_t* loaded = tiny_ptr_frozen_load(path.c_str());
+    ASSERT_NE(loaded, nullptr);
+    for (auto& kv : tps) {
+        EXPECT_EQ(tiny_ptr_frozen_dereference(loaded, kv.first, kv.second), 3 * (kv.first - 31000) + 7) << "Mismatch for key " << kv.first;
+    }
+    tiny_ptr_frozen_destroy(loaded);
+    std::remove(path.c_str());
+}
+
+// Test 4: Lookup by key recovers exactly the live tiny pointers stored under that key.
+TEST_P(TinyPtrVariants, FindByKey) {
+    tiny_ptr_table_t* table = tiny_ptr_create(2048, GetParam(), 0.9);
+    ASSERT_NE(table, nullptr);
+    for (int i = 0; i < 500; i++) {
+        tiny_ptr_allocate(table, i + 91000, i);
+    }
+    std::vector<int> tps;
+    for (int i = 0; i < 3; i++) {
+        int tp = tiny_ptr_allocate(table, 90000, 100 + i);
+        ASSERT_NE(tp, -1);
+        tps.push_back(tp);
+    }
+    tiny_ptr_free(table, 90000, tps[1]);
+    int found[8];
+    size_t count = tiny_ptr_find(table, 90000, found, 8);
+    ASSERT_EQ(count, 2u);
+    std::vector<int> got(found, found + count);
+    std::sort(got.begin(), got.end());
+    std::vector<int> expected = {tps[0], tps[2]};
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(got, expected);
+    for (size_t i = 0; i < count; i++) {
+        int value = tiny_ptr_dereference(table, 90000, found[i]);
+        EXPECT_TRUE(value == 100 || value == 102);
+    }
+    EXPECT_EQ(tiny_ptr_find(table, 90000, found, 1), 1u);
+    EXPECT_EQ(tiny_ptr_find(table, 89999, found, 8), 0u);
+    EXPECT_EQ(tiny_ptr_find(nullptr, 90000, found, 8), 0u);
+    tiny_ptr_destroy(table);
+}
+
+// Test 5: A cursor split into parts reports every live entry exactly once, with a working tiny pointer.
+TEST_P(TinyPtrVariants, CursorScan) {
+    tiny_ptr_table_t* table = tiny_ptr_create(4096, GetParam(), 0.9);
+    ASSERT_NE(table, nullptr);
+    std::map<int, int> live;
+    for (int i = 0; i < 3000; i++) {
+        int tp = tiny_ptr_allocate(table, i + 5000, i);
+        if (tp == -1) continue;
+        if (i % 3 == 0)
+            tiny_ptr_free(table, i + 5000, tp);
+        else
+            live[i + 5000] = i;
+    }
+    TinyPtrCursor cur;
+    EXPECT_EQ(tiny_ptr_cursor_open(table, &cur, 3, 3), -1);
+    EXPECT_EQ(tiny_ptr_cursor_open(nullptr, &cur, 0, 1), -1);
+    const size_t parts = 7;
+    std::vector<std::vector<std::array<int, 3>>> seen(parts);
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < parts; p++) {
+        threads.emplace_back([&, p] {
+            TinyPtrCursor c;
+            if (tiny_ptr_cursor_open(table, &c, p, parts) != 0) return;
+            int key, value, tp;
+            while (tiny_ptr_cursor_next(&c, &key, &value, &tp))
+                seen[p].push_back({key, value, tp});
+            tiny_ptr_cursor_close(&c);
+        });
+    }
+    for (auto& t : threads) t.join();
+    std::map<int, int> reported;
+    for (const auto& part : seen) {
+        for (const auto& e : part) {
+            EXPECT_EQ(reported.count(e[0]), 0u) << "Key " << e[0] << " reported twice";
+            reported[e[0]] = e[1];
+            EXPECT_EQ(tiny_ptr_dereference(table, e[0], e[2]), e[1]);
+        }
+    }
+    EXPECT_EQ(reported, live);
+    tiny_ptr_destroy(table);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllVariants, TinyPtrVariants,
+                         ::testing::Values(TINY_PTR_SIMPLE, TINY_PTR_FIXED, TINY_PTR_VARIABLE, TINY_PTR_SHARDED),
+                         variant_name);
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}